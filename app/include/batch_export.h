@@ -0,0 +1,55 @@
+// =====================
+// BatchExport.h
+// =====================
+// Headless command-line export (no GTK):
+//   docgen export --format=adoc|md|html [--jobs N] [--incremental] -o DIR FILE...
+// Every input (.docgenset or .docgenbook) becomes DIR/<name>.<ext>. Files
+// are spread across a pool of worker threads; each one is timed.
+// =====================
+
+#ifndef BATCH_EXPORT_H
+#define BATCH_EXPORT_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "export_job.h"
+
+struct BatchOptions {
+    ExportFormat format = ExportFormat::Markdown;
+    size_t jobs = 0;          // Worker threads, 0 = one per hardware thread
+    bool incremental = false; // Skip outputs that are already up to date
+    std::string output_dir;
+    std::vector<std::string> inputs;
+};
+
+struct BatchResult {
+    std::string input;
+    std::string output;
+    bool ok = false;
+    bool skipped = false;     // Up to date (incremental only)
+    bool removed = false;     // Input was deleted (watch only); output is set if it was deleted too
+    size_t sections = 0;
+    double milliseconds = 0;
+    std::string error;
+};
+
+class BatchExport {
+public:
+    // args are the words after "export"
+    static bool parseArguments(const std::vector<std::string>& args, BatchOptions& out, std::string& error);
+    static std::string outputPath(const BatchOptions& options, const std::string& input);
+
+    // Exports every input; on_done is called (serialized) as each file
+    // finishes. Results come back in input order.
+    static std::vector<BatchResult> run(const BatchOptions& options,
+                                        const std::function<void(const BatchResult&)>& on_done = nullptr);
+
+    // The whole "export" command: returns the process exit status
+    static int main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err);
+    static const char* usage();
+};
+
+#endif // BATCH_EXPORT_H
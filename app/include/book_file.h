@@ -0,0 +1,48 @@
+// =====================
+// BookFile.h
+// =====================
+// .docgenbook manifests: one document assembled from several .docgenset
+// files, without creating any widgets (no GTK).
+//
+// Text format, one directive per line; blank lines and lines starting with
+// '#' are ignored, and paths are relative to the manifest:
+//   title: <document title>
+//   include: <path> [offset=<n>]
+// An include names a .docgenset file or another .docgenbook. The offset
+// shifts the headline levels of everything it brings in (kept within I..III).
+// =====================
+
+#ifndef BOOK_FILE_H
+#define BOOK_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document_model.h"
+
+struct BookInclude {
+    std::string path;
+    int level_offset = 0;
+};
+
+struct BookManifest {
+    std::string title;
+    std::vector<BookInclude> includes;
+};
+
+class BookFile {
+public:
+    static bool parse(std::string_view text, BookManifest& out, std::string& error);
+    static bool isBookPath(const std::string& path); // True for *.docgenbook
+
+    // Resolves nested books depth-first (an include cycle is an error), loads
+    // every distinct set file once on up to `jobs` threads (0 = one per
+    // core), then appends all sections to out in manifest order. Section
+    // bodies stay in the set files' mappings. title is the manifest title,
+    // or the first set's title if the manifest has none.
+    static bool build(const std::string& filepath, DocumentModel& out, std::string& title,
+                      std::string& error, size_t jobs = 0);
+};
+
+#endif // BOOK_FILE_H
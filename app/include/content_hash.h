@@ -0,0 +1,48 @@
+// =====================
+// ContentHash.h
+// =====================
+// FNV-1a hashing of section data (no GTK).
+// Used to tell content apart (fragment cache, export manifests); it is not
+// a cryptographic hash.
+// =====================
+
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstdint>
+#include <string_view>
+#include "document_model.h"
+
+constexpr uint64_t kHashSeed = 14695981039346656037ull;
+
+inline uint64_t hashBytes(std::string_view data, uint64_t hash = kHashSeed) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashValue(uint64_t value, uint64_t hash) {
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Field lengths go into the hash too, so ("ab", "c") and ("a", "bc") differ
+inline uint64_t hashField(std::string_view field, uint64_t hash) {
+    return hashBytes(field, hashValue(field.size(), hash));
+}
+
+// Everything a section's rendering depends on
+inline uint64_t hashSection(const SectionData& section) {
+    uint64_t hash = hashField(section.header, kHashSeed);
+    hash = hashField(section.headline, hash);
+    hash = hashValue(static_cast<uint64_t>(section.level), hash);
+    hash = hashField(section.type, hash);
+    return hashField(section.body(), hash);
+}
+
+#endif // CONTENT_HASH_H
@@ -0,0 +1,78 @@
+// =====================
+// DocumentModel.h
+// =====================
+// Plain C++ document model (no GTK).
+// Holds the ordered sections and generates AsciiDoc/Markdown from them
+// (see DocumentWriter for the formats).
+// =====================
+
+#ifndef DOCUMENT_MODEL_H
+#define DOCUMENT_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ----- Section Record -----
+struct SectionData {
+    uint64_t id = 0;             // Stable section ID, assigned by DocumentModel
+    std::string header;          // Section header (source file name)
+    std::string headline;        // Headline text
+    int level = 1;               // Headline level (I/II/III)
+    std::string type = "text";   // Section type (text/quote/box)
+    std::string content;         // Section body, once owned (see body())
+    uint64_t revision = 0;       // Bumped on every edit; render caches key on it
+
+    // Lazily loaded body: a view into a mapped set file, kept alive by content_owner
+    std::string_view content_ref;
+    std::shared_ptr<const void> content_owner;
+
+    std::string_view body() const { return content_owner ? content_ref : std::string_view(content); }
+    bool isContentLoaded() const { return !content_owner; }
+    void setContent(std::string text) { // Replaces (and releases) any lazy body
+        content = std::move(text);
+        ++revision;
+        content_ref = std::string_view();
+        content_owner.reset();
+    }
+};
+
+class DocumentModel {
+public:
+    // ----- Section Access -----
+    size_t size() const { return sections_.size(); }
+    bool empty() const { return sections_.empty(); }
+    SectionData& at(size_t index) { return sections_.at(index); }
+    const SectionData& at(size_t index) const { return sections_.at(index); }
+    const std::vector<SectionData>& sections() const { return sections_; }
+
+    // ----- ID Lookup (O(1)) -----
+    int indexOf(uint64_t id) const; // -1 if no such section
+    SectionData* find(uint64_t id);
+    const SectionData* find(uint64_t id) const;
+
+    // ----- Section Operations -----
+    size_t append(SectionData section); // Assigns an ID if unset; returns the new index
+    void erase(size_t index);
+    // order[i] = old index of new position i; false (and unchanged) unless
+    // order is a permutation of every index
+    bool reorder(const std::vector<size_t>& order);
+    void clear();
+
+    // ----- Document Generation -----
+    std::string generateAsciiDoc(const std::string& title = "") const;
+    std::string generateMarkdown(const std::string& title = "") const;
+
+private:
+    std::vector<SectionData> sections_;
+    std::unordered_map<uint64_t, size_t> index_; // Section ID -> position in sections_
+    uint64_t next_id_ = 1;
+
+    void reindexFrom(size_t start);
+};
+
+#endif // DOCUMENT_MODEL_H
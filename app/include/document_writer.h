@@ -0,0 +1,233 @@
+// =====================
+// DocumentWriter.h
+// =====================
+// Compile-time specialized document writer (no GTK).
+// DocumentWriter<Format> renders sections using a format policy's constexpr
+// heading and block tables; output goes to any sink with append(string_view),
+// including FileSink for streaming exports.
+// =====================
+
+#ifndef DOCUMENT_WRITER_H
+#define DOCUMENT_WRITER_H
+
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document_model.h"
+#include "file_sink.h"
+#include "parallel.h"
+
+// ----- Block Kinds -----
+enum class BlockKind { Text = 0, Quote = 1, Box = 2 };
+
+inline BlockKind blockKind(std::string_view type) {
+    if (type == "quote") return BlockKind::Quote;
+    if (type == "box") return BlockKind::Box;
+    return BlockKind::Text;
+}
+
+// How a section body is wrapped. With a line prefix the body is written line
+// by line (a trailing newline does not start another line); otherwise verbatim.
+struct BlockStyle {
+    std::string_view open;
+    std::string_view line_prefix;
+    std::string_view close;
+};
+
+// ----- Format Policies -----
+struct AsciiDocFormat {
+    static constexpr std::string_view kTitlePrefix = "= ";
+    // Index 0 is used for levels outside 1..3
+    static constexpr std::string_view kHeadings[4] = {"=== ", "== ", "=== ", "==== "};
+    static constexpr bool kHeaderFallback = true; // Without a headline, write the header unmarked
+    static constexpr BlockStyle kBlocks[3] = {
+        {"", "", "\n\n"},                       // text
+        {"[quote]\n____\n", "", "\n____\n\n"},  // quote
+        {"****\n", "", "\n****\n\n"},           // box (sidebar)
+    };
+};
+
+struct MarkdownFormat {
+    static constexpr std::string_view kTitlePrefix = "# ";
+    static constexpr std::string_view kHeadings[4] = {"### ", "## ", "### ", "#### "};
+    static constexpr bool kHeaderFallback = false; // Without a headline, no heading at all
+    static constexpr BlockStyle kBlocks[3] = {
+        {"", "", "\n\n"},               // text
+        {"", "> ", "\n"},               // quote (blockquote lines)
+        {"```\n", "", "\n```\n\n"},     // box (code block)
+    };
+};
+
+// ----- Sinks -----
+struct StringSink {
+    std::string& out;
+    void append(std::string_view text) { out.append(text.data(), text.size()); }
+};
+
+struct CountingSink {
+    size_t size = 0;
+    void append(std::string_view text) { size += text.size(); }
+};
+
+// Writes into memory the caller has already sized (see DocumentWriter::measure)
+struct BufferSink {
+    char* pos;
+    void append(std::string_view text) {
+        if (!text.empty()) std::memcpy(pos, text.data(), text.size());
+        pos += text.size();
+    }
+};
+
+// ----- Writer -----
+template <typename Format>
+class DocumentWriter {
+public:
+    template <typename Sink>
+    static void writeTitle(Sink& out, std::string_view title) {
+        if (!title.empty()) {
+            out.append(Format::kTitlePrefix);
+            out.append(title);
+            out.append("\n\n");
+        }
+    }
+
+    template <typename Sink>
+    static void writeSection(Sink& out, const SectionData& section) {
+        if (!section.headline.empty()) {
+            out.append(heading(section.level));
+            out.append(section.headline);
+            out.append("\n\n");
+        } else if constexpr (Format::kHeaderFallback) {
+            out.append(section.header);
+            out.append("\n\n");
+        }
+
+        const BlockStyle& block = Format::kBlocks[static_cast<int>(blockKind(section.type))];
+        std::string_view body = section.body();
+        out.append(block.open);
+        if (block.line_prefix.empty()) {
+            out.append(body);
+        } else {
+            size_t start = 0;
+            while (start < body.size()) {
+                size_t newline = body.find('\n', start);
+                size_t end = newline == std::string_view::npos ? body.size() : newline;
+                out.append(block.line_prefix);
+                out.append(body.substr(start, end - start));
+                out.append("\n");
+                start = end + 1;
+            }
+        }
+        out.append(block.close);
+    }
+
+    template <typename Sink>
+    static void writeDocument(Sink& out, const DocumentModel& model, std::string_view title) {
+        writeTitle(out, title);
+        for (const auto& section : model.sections()) {
+            writeSection(out, section);
+        }
+    }
+
+    // Exact output size, for sizing buffers before writing
+    static size_t measure(const DocumentModel& model, std::string_view title) {
+        CountingSink counter;
+        writeDocument(counter, model, title);
+        return counter.size;
+    }
+
+    static size_t measureSection(const SectionData& section) {
+        CountingSink counter;
+        writeSection(counter, section);
+        return counter.size;
+    }
+
+    // Output offset of every section (after the title); the extra last entry
+    // is the document size. Sections are measured in parallel.
+    static std::vector<size_t> sectionOffsets(const DocumentModel& model, std::string_view title, size_t jobs = 0) {
+        const auto& sections = model.sections();
+        std::vector<size_t> offsets(sections.size() + 1);
+        CountingSink title_size;
+        writeTitle(title_size, title);
+        offsets[0] = title_size.size;
+        forEachBlock(sections.size(), jobs, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                offsets[i + 1] = measureSection(sections[i]);
+            }
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        return offsets;
+    }
+
+    // Whole document in one exactly sized allocation. Large documents are
+    // rendered block by block on several threads, each block written at its
+    // prefix-sum offset, so the output is identical to the serial pass.
+    static std::string render(const DocumentModel& model, std::string_view title, size_t jobs = 0) {
+        const auto& sections = model.sections();
+        if (sections.size() < kMinParallelSections) {
+            std::string result(measure(model, title), '\0');
+            BufferSink sink{&result[0]};
+            writeDocument(sink, model, title);
+            return result;
+        }
+
+        std::vector<size_t> offsets = sectionOffsets(model, title, jobs);
+        std::string result(offsets.back(), '\0');
+        BufferSink title_sink{&result[0]};
+        writeTitle(title_sink, title);
+        forEachBlock(sections.size(), jobs, [&](size_t first, size_t last) {
+            BufferSink sink{&result[0] + offsets[first]};
+            for (size_t i = first; i < last; ++i) {
+                writeSection(sink, sections[i]);
+            }
+        });
+        return result;
+    }
+
+    // Calls fn(first, last) for consecutive blocks of sections, in parallel
+    // once there are enough sections to be worth the threads
+    template <typename Fn>
+    static void forEachBlock(size_t count, size_t jobs, Fn fn) {
+        size_t blocks = (count + kBlockSections - 1) / kBlockSections;
+        parallelFor(blocks, count >= kMinParallelSections ? jobs : 1, [&](size_t block) {
+            size_t first = block * kBlockSections;
+            fn(first, std::min(first + kBlockSections, count));
+        });
+    }
+
+    static constexpr size_t kMinParallelSections = 1024;
+    static constexpr size_t kBlockSections = 64;
+
+    // Streams the document into filepath section by section (preallocated,
+    // replaced atomically); memory use does not grow with the document
+    static bool writeFile(const std::string& filepath, const DocumentModel& model, std::string_view title) {
+        FileSink sink;
+        if (!sink.open(filepath, measure(model, title))) {
+            return false;
+        }
+        writeDocument(sink, model, title);
+        return sink.commit();
+    }
+
+    static void appendTitle(std::string_view title, std::string& result) {
+        StringSink sink{result};
+        writeTitle(sink, title);
+    }
+
+    static void appendSection(const SectionData& section, std::string& result) {
+        result.reserve(result.size() + measureSection(section));
+        StringSink sink{result};
+        writeSection(sink, section);
+    }
+
+private:
+    static std::string_view heading(int level) {
+        return level >= 1 && level <= 3 ? Format::kHeadings[level] : Format::kHeadings[0];
+    }
+};
+
+#endif // DOCUMENT_WRITER_H
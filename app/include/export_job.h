@@ -0,0 +1,110 @@
+// =====================
+// ExportJob.h
+// =====================
+// One document export, run on a worker thread (no GTK).
+// The job owns a snapshot of the model, so the UI can keep editing while it
+// renders and writes; progress and cancellation are safe from any thread.
+// A job can write several formats from a single pass over the sections.
+// =====================
+
+#ifndef EXPORT_JOB_H
+#define EXPORT_JOB_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "document_model.h"
+#include "export_manifest.h"
+
+enum class ExportFormat { AsciiDoc, Markdown, Html };
+
+struct ExportTarget {
+    ExportFormat format;
+    std::string filepath;
+    // AsciiDoc/Markdown only: filepath becomes an index of per-chapter files
+    bool split_chapters = false;
+};
+
+// ----- Chapters -----
+// A chapter starts at every level-I section with a headline; sections before
+// the first one form a chapter of their own
+struct ChapterRange {
+    size_t first; // Section indices [first, last)
+    size_t last;
+};
+std::vector<ChapterRange> splitChapters(const DocumentModel& model);
+// "book.md" -> "book-01.md"; numbers are padded to the width of count
+std::string chapterFilePath(const std::string& index_path, size_t chapter, size_t count);
+
+class ExportJob {
+public:
+    enum class Status { Pending, Done, Failed, Cancelled };
+
+    // jobs: render threads for a single AsciiDoc/Markdown target, 0 = one
+    // per hardware thread
+    ExportJob(DocumentModel snapshot, std::string title, std::string filepath, ExportFormat format,
+              size_t jobs = 0);
+    ExportJob(DocumentModel snapshot, std::string title, std::vector<ExportTarget> targets, size_t jobs = 0);
+
+    // ----- Options -----
+    // Keep a manifest next to the first target and skip every output file
+    // whose inputs and on-disk state are unchanged since the last export
+    void setIncremental(bool incremental) { incremental_ = incremental; }
+    // Assemble the snapshot from a .docgenbook on the worker thread instead
+    // (see BookFile); an empty title is taken from the book
+    void setBookSource(std::string book_path) { book_path_ = std::move(book_path); }
+
+    // ----- Worker Thread -----
+    // A single AsciiDoc/Markdown target is rendered in parallel blocks, or
+    // split into chapter files written concurrently; otherwise every section
+    // is rendered once per target in one pass. Cancellation is checked
+    // between blocks or sections.
+    Status run();
+
+    // ----- Any Thread -----
+    void cancel() { cancelled_ = true; }
+    bool isCancelled() const { return cancelled_; }
+    double progress() const; // Fraction of sections written, 0..1
+
+    // ----- Job Data -----
+    const std::vector<ExportTarget>& targets() const { return targets_; }
+    size_t sectionCount() const { return model_.size(); }
+    size_t filesWritten() const { return files_written_; } // After run()
+    size_t filesSkipped() const { return files_skipped_; }
+    const std::string& error() const { return error_; } // Why run() failed, if known
+
+private:
+    DocumentModel model_; // Lazy bodies share the set file mapping; edited ones are copies
+    std::string title_;
+    std::vector<ExportTarget> targets_;
+    size_t jobs_;
+    std::string book_path_;
+    std::string error_;
+    std::atomic<size_t> sections_total_{0}; // model_ may still be filled in by run()
+    std::atomic<size_t> sections_done_{0};
+    std::atomic<bool> cancelled_{false};
+
+    // Incremental export state (worker thread only)
+    bool incremental_ = false;
+    ExportManifest previous_; // Last export with the same options
+    ExportManifest manifest_; // This export
+    size_t files_written_ = 0;
+    size_t files_skipped_ = 0;
+
+    Status writeTargets();
+    template <typename Format>
+    Status writeParallel(const ExportTarget& target);
+    template <typename Format>
+    Status writeChapters(const ExportTarget& target);
+    Status writeSinglePass();
+
+    void prepareManifest();
+    Status finishManifest(Status status);
+    uint64_t rangeHash(ExportFormat format, size_t first, size_t last, bool with_title) const;
+    bool skipIfCurrent(const std::string& path, uint64_t input_hash);
+    void recordWritten(const std::string& path, uint64_t input_hash);
+};
+
+#endif // EXPORT_JOB_H
@@ -0,0 +1,45 @@
+// =====================
+// ExportManifest.h
+// =====================
+// Sidecar record of what an export last wrote (no GTK).
+// For every output file it keeps the hash of the inputs that produced it and
+// the file's size and mtime, so a re-export can leave unchanged files alone.
+// =====================
+
+#ifndef EXPORT_MANIFEST_H
+#define EXPORT_MANIFEST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class ExportManifest {
+public:
+    struct Entry {
+        uint64_t input_hash = 0;
+        uint64_t size = 0;
+        int64_t mtime_ns = 0;
+    };
+
+    // ".<name>.docgen-manifest" next to the export's main output file
+    static std::string pathFor(const std::string& output_path);
+
+    // ----- Load & Save -----
+    bool load(const std::string& path); // false (and empty) if missing or unreadable
+    bool save(const std::string& path) const;
+
+    // ----- Contents -----
+    std::string options;                   // Format and layout of the export
+    uint64_t set_hash = 0;                 // Title plus all section hashes
+    std::vector<uint64_t> section_hashes;  // In document order
+    std::map<std::string, Entry> files;    // Output path -> entry
+
+    // True if path was recorded with input_hash and is unchanged on disk
+    bool isCurrent(const std::string& path, uint64_t input_hash) const;
+    bool record(const std::string& path, uint64_t input_hash); // Stats the file just written
+
+    static constexpr int kVersion = 2; // Bump when rendered output changes
+};
+
+#endif // EXPORT_MANIFEST_H
@@ -0,0 +1,85 @@
+// =====================
+// FileSink.h
+// =====================
+// Buffered, atomically committed output file (no GTK).
+// Data is gathered into iovecs and written with writev into a temporary
+// sibling file, which commit() renames over the target. Disjoint byte ranges
+// can also be filled from several threads with FileRangeWriter.
+// =====================
+
+#ifndef FILE_SINK_H
+#define FILE_SINK_H
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/uio.h>
+
+// Creates an empty temporary file next to filepath, with the permissions
+// filepath has (or would get). Returns the open descriptor, or -1.
+int createTempSibling(const std::string& filepath, std::string& temp_path);
+
+class FileSink {
+public:
+    explicit FileSink(size_t buffer_size = 1 << 20);
+    ~FileSink(); // Discards the temporary file unless committed
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    // ----- Output -----
+    bool open(const std::string& filepath, uint64_t expected_size = 0); // expected_size preallocates
+    // Small pieces are copied into the buffer. Pieces of at least
+    // kDirectThreshold bytes are referenced, not copied, and must stay
+    // valid until the next flush() or commit().
+    void append(std::string_view text);
+    bool flush();
+    // Writes data at offset, bypassing the buffer (pwrite). Safe to call
+    // from several threads as long as the ranges do not overlap.
+    bool writeAt(uint64_t offset, std::string_view data);
+    bool commit(); // Flushes and renames the temporary file into place
+    void abort();  // Removes the temporary file
+
+    // ----- State -----
+    bool ok() const { return fd_ >= 0 && !failed_; }
+    uint64_t bytesWritten() const { return written_; }
+
+    static constexpr size_t kDirectThreshold = 64 * 1024;
+
+private:
+    int fd_ = -1;
+    std::atomic<bool> failed_{false};
+    std::string path_;
+    std::string temp_path_;
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_size_;
+    size_t buffer_used_ = 0;
+    std::vector<struct iovec> pending_;
+    std::atomic<uint64_t> written_{0};
+};
+
+// Sequential, buffered writer for one byte range of a FileSink. Each thread
+// uses its own writer on its own range; pieces of at least
+// FileSink::kDirectThreshold bytes are written straight from the caller.
+class FileRangeWriter {
+public:
+    FileRangeWriter(FileSink& file, uint64_t offset, size_t buffer_size = 256 * 1024);
+    ~FileRangeWriter() { flush(); }
+    FileRangeWriter(const FileRangeWriter&) = delete;
+    FileRangeWriter& operator=(const FileRangeWriter&) = delete;
+
+    void append(std::string_view text);
+    bool flush();
+
+private:
+    FileSink& file_;
+    uint64_t offset_; // File offset of buffer_[0]
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_size_;
+    size_t buffer_used_ = 0;
+};
+
+#endif // FILE_SINK_H
@@ -0,0 +1,83 @@
+// =====================
+// FragmentCache.h
+// =====================
+// Caches each section's rendered AsciiDoc, Markdown and HTML fragments so
+// regenerating a document only re-renders the sections that changed
+// (no GTK).
+// =====================
+
+#ifndef FRAGMENT_CACHE_H
+#define FRAGMENT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "document_model.h"
+#include "html_renderer.h"
+
+enum class FragmentFormat { AsciiDoc = 0, Markdown = 1, Html = 2 };
+
+// HTML of one section, or of the document title
+struct HtmlBlock {
+    uint64_t key = 0;  // Section ID, 0 for the document title
+    std::string html;
+    uint64_t hash = 0; // Of html
+};
+
+class FragmentCache {
+public:
+    // ----- Document Generation -----
+    // Concatenates cached fragments, rendering only sections whose entry is stale
+    std::string generate(const DocumentModel& model, FragmentFormat format, const std::string& title = "");
+    std::string generateHtmlPage(const DocumentModel& model, const std::string& title = "");
+    std::string generateHtmlDocument(const DocumentModel& model, const std::string& title = ""); // Exported page
+    // Same HTML as the page body, split into blocks for patching a live page.
+    // Polled between sections, cancelled() abandons the render (empty result).
+    std::vector<HtmlBlock> generateHtmlBlocks(const DocumentModel& model, const std::string& title = "",
+                                              const std::function<bool()>& cancelled = nullptr);
+
+    // ----- Cache Management -----
+    void clear();
+    size_t size() const { return entries_.size(); }
+    size_t renderCount() const { return renders_; } // Fragments rendered so far
+
+private:
+    static constexpr size_t kFormatCount = 3;
+
+    // A section's rendering depends only on these
+    struct Key {
+        uint64_t content_hash = 0;
+        std::string header;
+        std::string headline;
+        int level = 0;
+        std::string type;
+
+        bool operator==(const Key& other) const {
+            return content_hash == other.content_hash && level == other.level &&
+                   header == other.header && headline == other.headline && type == other.type;
+        }
+    };
+
+    struct Entry {
+        uint64_t revision = 0;
+        Key key;
+        std::string fragments[kFormatCount];
+        bool rendered[kFormatCount] = {false, false, false};
+        uint64_t seen = 0; // Generation that last used this entry
+    };
+
+    std::unordered_map<uint64_t, Entry> entries_; // Section ID -> entry
+    uint64_t generation_ = 0;
+    size_t renders_ = 0;
+
+    Entry& entryFor(const SectionData& section);
+    const std::string& fragment(const SectionData& section, Entry& entry, FragmentFormat format);
+    void appendHtmlBody(const DocumentModel& model, const std::string& title, std::string& html);
+    void sweep(const DocumentModel& model);
+    static Key makeKey(const SectionData& section);
+};
+
+#endif // FRAGMENT_CACHE_H
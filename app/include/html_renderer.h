@@ -0,0 +1,155 @@
+// =====================
+// HtmlRenderer.h
+// =====================
+// Renders sections straight to the HTML shown in the preview and written by
+// HTML exports (no GTK). Headings, quotes and boxes come from each section's
+// level and type, and all text is escaped, so section content is never
+// interpreted as markup. Output goes to any DocumentWriter sink.
+// =====================
+
+#ifndef HTML_RENDERER_H
+#define HTML_RENDERER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "document_model.h"
+#include "document_writer.h"
+
+// ----- Scanning -----
+// Position of the first byte at or after from that needs an entity (&, <, >
+// or "), or with newlines also of the first '\n'; text.size() if there is
+// none. Scans 32 or 16 bytes at a time with AVX2 or SSE2 when the CPU has
+// them, otherwise through a byte class table.
+size_t findHtmlSpecial(std::string_view text, size_t from, bool newlines);
+std::string_view htmlEntity(char c); // Entity for a byte findHtmlSpecial stops at, other than '\n'
+
+// ----- Escaping -----
+// Writes text with its special bytes replaced by entities; runs without them
+// are appended as they are (still referencing text)
+template <typename Sink>
+void writeEscapedHtml(Sink& out, std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t next = findHtmlSpecial(text, pos, false);
+        if (next > pos) out.append(text.substr(pos, next - pos));
+        if (next == text.size()) break;
+        out.append(htmlEntity(text[next]));
+        pos = next + 1;
+    }
+}
+
+// ----- Writer -----
+// Text bodies become paragraphs (split at blank lines), quotes a
+// <blockquote> with one line per source line, boxes a <pre><code> block.
+// Each section's HTML is complete on its own.
+class HtmlWriter {
+public:
+    template <typename Sink>
+    static void writeTitle(Sink& out, std::string_view title) {
+        if (!title.empty()) {
+            out.append("<h1>");
+            writeEscapedHtml(out, title);
+            out.append("</h1>\n");
+        }
+    }
+
+    template <typename Sink>
+    static void writeSection(Sink& out, const SectionData& section) {
+        if (!section.headline.empty()) {
+            std::string_view tag = headingTag(section.level);
+            out.append("<");
+            out.append(tag);
+            out.append(">");
+            writeEscapedHtml(out, section.headline);
+            out.append("</");
+            out.append(tag);
+            out.append(">\n");
+        }
+
+        std::string_view body = section.body();
+        switch (blockKind(section.type)) {
+            case BlockKind::Text:
+                writeParagraphs(out, body);
+                break;
+            case BlockKind::Quote:
+                if (body.empty()) break;
+                out.append("<blockquote>");
+                for (size_t pos = 0; pos < body.size();) {
+                    pos = writeEscapedLine(out, body, pos);
+                    out.append("<br>\n");
+                }
+                out.append("</blockquote>\n");
+                break;
+            case BlockKind::Box:
+                out.append("<pre><code>");
+                writeEscapedHtml(out, body);
+                out.append("\n</code></pre>\n");
+                break;
+        }
+    }
+
+    template <typename Sink>
+    static void writeDocument(Sink& out, const DocumentModel& model, std::string_view title) {
+        writeTitle(out, title);
+        for (const auto& section : model.sections()) {
+            writeSection(out, section);
+        }
+    }
+
+    static void appendTitle(std::string_view title, std::string& result) {
+        StringSink sink{result};
+        writeTitle(sink, title);
+    }
+
+    static void appendSection(const SectionData& section, std::string& result) {
+        StringSink sink{result};
+        writeSection(sink, section);
+    }
+
+private:
+    // Level I..III sit below the document title; other levels use level II's
+    static std::string_view headingTag(int level) {
+        static constexpr std::string_view kTags[4] = {"h3", "h2", "h3", "h4"};
+        return level >= 1 && level <= 3 ? kTags[level] : kTags[0];
+    }
+
+    // Writes the escaped line starting at pos and returns the position after
+    // its newline. Line breaks and escapes are found in the same scan.
+    template <typename Sink>
+    static size_t writeEscapedLine(Sink& out, std::string_view text, size_t pos) {
+        for (;;) {
+            size_t next = findHtmlSpecial(text, pos, true);
+            if (next > pos) out.append(text.substr(pos, next - pos));
+            if (next == text.size()) return next;
+            if (text[next] == '\n') return next + 1;
+            out.append(htmlEntity(text[next]));
+            pos = next + 1;
+        }
+    }
+
+    // A trailing newline does not start another line
+    template <typename Sink>
+    static void writeParagraphs(Sink& out, std::string_view body) {
+        bool open = false;
+        for (size_t pos = 0; pos < body.size();) {
+            if (body[pos] == '\n') {
+                if (open) out.append("</p>\n");
+                open = false;
+                ++pos;
+                continue;
+            }
+            out.append(open ? "\n" : "<p>");
+            pos = writeEscapedLine(out, body, pos);
+            open = true;
+        }
+        if (open) out.append("</p>\n");
+    }
+};
+
+// ----- Page Assembly -----
+const std::string& htmlPageHead();     // Doctype, styles and <body> for the scaled preview
+const std::string& htmlDocumentHead(); // Same, for a standalone exported page
+const std::string& htmlPageTail();
+
+#endif // HTML_RENDERER_H
@@ -11,6 +11,11 @@
 #include <gtk/gtk.h>
 #include <webkit2/webkit2.h>
 #include <memory>
+#include <mutex>
+#include <vector>
+#include "export_job.h"
+#include "preview_patcher.h"
+#include "preview_renderer.h"
 #include "section_manager.h"
 #include "text_viewer.h"
 
@@ -39,8 +44,8 @@ private:
     // ----- UI Creation Methods -----
     void createMenuBar();
     void createUI();
-    void updatePreview();
-    std::string convertAsciiDocToHTML(const std::string& asciidoc);
+    void updatePreview(); // Requests a background render of the current model
+    void createExportBar();
 
     // ----- Menu Callbacks (static for GTK compatibility) -----
     static void onAddSection(GtkMenuItem* item, gpointer user_data);
@@ -48,17 +53,74 @@ private:
     static void onOpenSet(GtkMenuItem* item, gpointer user_data);
     static void onCreateDoc(GtkMenuItem* item, gpointer user_data);
     static void onCreateMarkdown(GtkMenuItem* item, gpointer user_data);
+    static void onExportAll(GtkMenuItem* item, gpointer user_data); // .adoc, .md and .html in one pass
+    static void onExportChapters(GtkMenuItem* item, gpointer user_data); // One file per level-I chapter
+    static void onExportBook(GtkMenuItem* item, gpointer user_data); // A .docgenbook of several sets
     static void onClearAll(GtkMenuItem* item, gpointer user_data);
     static void onQuit(GtkMenuItem* item, gpointer user_data);
     static void onAbout(GtkMenuItem* item, gpointer user_data);
 
+    // ----- Preview Callbacks -----
+    // Edited sections are handed to a PreviewRenderer worker, which renders
+    // its own copy of the model; only the newest result reaches WebKit, through
+    // the main loop.
+    struct PreviewResult {
+        uint64_t generation = 0;
+        std::vector<HtmlBlock> blocks;
+    };
+    void applyPreview(std::vector<HtmlBlock> blocks); // Patches the loaded page; loads it only the first time
+    static gboolean onPreviewRendered(gpointer user_data);
+    static void onPreviewLoadChanged(WebKitWebView* web_view, WebKitLoadEvent event, gpointer user_data);
+    // Fill and drop requests from the page script (see PreviewPatcher)
+    static void onPreviewMessage(WebKitUserContentManager* manager, WebKitJavascriptResult* message,
+                                 gpointer user_data);
+    static void onPreviewProcessTerminated(WebKitWebView* web_view, WebKitWebProcessTerminationReason reason,
+                                           gpointer user_data);
+    void runPreviewScript(const std::string& script);
+
     // ----- Helper Methods -----
     bool promptSaveIfNeeded();
     void updateTitle();
+    bool saveSetFile(const std::string& filepath); // Saves sections plus the document title
+    bool ensureSetSaved(); // Prompts to save a new or modified set; false if not saved
+
+    // ----- Background Export -----
+    // The model is snapshotted on the main thread, then rendered and written
+    // by a GTask worker; the result comes back through the main loop.
+    struct ExportRun {
+        MainWindow* window; // Cleared if the window goes away first
+        ExportJob job;
+    };
+    bool ensureNoExportRunning(); // Reports a running export; false if busy
+    // With a book path the job assembles its own model from that book
+    void startExport(std::vector<ExportTarget> targets, const std::string& book_path = "");
+    void finishExport(const ExportJob& job, ExportJob::Status status);
+    static void exportThread(GTask* task, gpointer source_object, gpointer task_data,
+                             GCancellable* cancellable);
+    static void onExportFinished(GObject* source_object, GAsyncResult* result, gpointer user_data);
+    static gboolean onExportProgress(gpointer user_data);
+    static void onCancelExport(GtkButton* button, gpointer user_data);
 
     // ----- State Tracking -----
     bool has_unsaved_changes_;
     std::string current_set_file_;
+
+    // ----- Export State -----
+    GtkWidget* export_bar_;
+    GtkWidget* export_label_;
+    GtkWidget* export_progress_;
+    GtkWidget* export_cancel_button_;
+    ExportRun* export_run_; // Owned by the running task
+    guint export_progress_id_;
+
+    // ----- Preview State -----
+    PreviewPatcher preview_patcher_;              // What the loaded preview page shows
+    bool preview_loaded_;                         // Patches can run (page load finished)
+    std::vector<HtmlBlock> preview_pending_;      // Newest blocks, held while the page loads
+    std::unique_ptr<PreviewRenderer> preview_renderer_;
+    std::mutex preview_mutex_;                    // Guards the two members below
+    PreviewResult preview_result_;                // Newest render, not yet applied
+    guint preview_idle_id_;                       // Idle source applying preview_result_
 };
 
 #endif // MAIN_WINDOW_H
@@ -0,0 +1,68 @@
+// =====================
+// Parallel.h
+// =====================
+// Minimal std::thread helpers for splitting independent work (no GTK).
+// =====================
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ----- Job Count -----
+// 0 means "one job per hardware thread"
+inline size_t resolveJobs(size_t jobs) {
+    if (jobs == 0) {
+        jobs = std::thread::hardware_concurrency();
+    }
+    return jobs == 0 ? 1 : jobs;
+}
+
+// ----- Parallel Loop -----
+// Calls fn(i) for every i in [0, count) on up to `jobs` threads and waits
+// for all of them. Items are handed out one at a time, so uneven items
+// balance out. The first exception thrown by fn is rethrown here.
+template <typename Fn>
+void parallelFor(size_t count, size_t jobs, Fn fn) {
+    size_t threads = std::min(resolveJobs(jobs), count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,64 @@
+// =====================
+// PreviewPatcher.h
+// =====================
+// Keeps a live preview page up to date without reloading it (no GTK).
+// The page is loaded once with one anchored element per HtmlBlock; after
+// that, patch() produces a JavaScript call that replaces only the blocks
+// whose HTML changed and moves or removes the others. Blocks are compared by
+// their hash, so an update costs the main thread little beyond the changes.
+// Only blocks near the visible part of the page hold their HTML; the others
+// are placeholders of estimated height, filled when the page script reports
+// them in view and emptied again once they scroll far away.
+// =====================
+
+#ifndef PREVIEW_PATCHER_H
+#define PREVIEW_PATCHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "fragment_cache.h"
+
+class PreviewPatcher {
+public:
+    // Whole preview page, with the first kInitialBlocks blocks filled in; it
+    // becomes what later patches are made against
+    std::string page(std::vector<HtmlBlock> blocks);
+    // Call of docgenPatch() turning the current page into blocks, or an
+    // empty string if nothing changed. Blocks not shown only get their
+    // placeholder height updated.
+    std::string patch(std::vector<HtmlBlock> blocks);
+    // Answers a "fill <key>..." or "drop <key>..." message from the page
+    // script: returns the docgenFill() call for the blocks to fill, or an
+    // empty string
+    std::string handleMessage(std::string_view message);
+    void reset() { has_page_ = false; } // The page is gone; the next update needs page()
+    bool hasPage() const { return has_page_; }
+    size_t shownCount() const { return shown_.size(); } // Blocks whose HTML is on the page
+
+    // Placeholder height in CSS pixels, from the size of the block's HTML
+    static int estimateHeight(const HtmlBlock& block);
+
+    // Defines docgenPatch(order, changed, placeholders) and docgenFill(filled)
+    // in the page, and posts fill/drop messages to the "docgen" script
+    // message handler as blocks come near the viewport or leave it. order is
+    // the block key list (null if unchanged), changed and filled map keys to
+    // their HTML, placeholders map keys to heights.
+    static const std::string& script();
+
+    static constexpr size_t kInitialBlocks = 64;
+
+private:
+    bool has_page_ = false;
+    std::vector<HtmlBlock> blocks_;               // As on the page, in order
+    std::unordered_map<uint64_t, size_t> index_;  // Block key -> position in blocks_
+    std::unordered_set<uint64_t> shown_;          // Keys of blocks filled in on the page
+
+    void remember(std::vector<HtmlBlock> blocks);
+};
+
+#endif // PREVIEW_PATCHER_H
@@ -0,0 +1,80 @@
+// =====================
+// PreviewRenderer.h
+// =====================
+// Renders the live preview on a worker thread (no GTK).
+// The worker keeps its own copy of the sections. A request carries only the
+// section order and the sections whose revision changed since the previous
+// request, and gets a new generation number. The worker renders only the
+// newest request: a request arriving mid-render abandons the older render
+// between sections, and results that are already stale are dropped instead
+// of delivered.
+// =====================
+
+#ifndef PREVIEW_RENDERER_H
+#define PREVIEW_RENDERER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "document_model.h"
+#include "fragment_cache.h"
+
+class PreviewRenderer {
+public:
+    // Called on the worker thread with a finished render; the receiver
+    // should still compare generation with latest() once it is back on its
+    // own thread, since a newer request may have arrived meanwhile
+    using Deliver = std::function<void(uint64_t generation, std::vector<HtmlBlock> blocks)>;
+
+    explicit PreviewRenderer(Deliver deliver);
+    ~PreviewRenderer(); // Abandons any render and joins the worker; no delivery after this
+    PreviewRenderer(const PreviewRenderer&) = delete;
+    PreviewRenderer& operator=(const PreviewRenderer&) = delete;
+
+    // ----- Requesting Thread -----
+    // Sends the changes in model since the last request, replacing any
+    // request not yet started; returns its generation. Section IDs must not
+    // be reused for other sections, and all requests come from one thread.
+    uint64_t request(const DocumentModel& model, std::string title);
+    size_t sectionsSent() const { return sent_count_; } // Sections copied into requests so far
+
+    // ----- Any Thread -----
+    uint64_t latest() const { return generation_; }
+    size_t renderCount() const { return renders_; } // Renders delivered so far
+
+private:
+    Deliver deliver_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<uint64_t> generation_{0};
+    std::atomic<size_t> renders_{0};
+    bool stopping_ = false;
+
+    // Requesting thread only: revision of each section as last sent
+    std::unordered_map<uint64_t, uint64_t> sent_;
+    size_t sent_count_ = 0;
+
+    // Newest request not yet picked up (guarded by mutex_); sections changed
+    // by requests the worker skipped accumulate
+    bool pending_ = false;
+    std::vector<uint64_t> pending_order_;
+    std::unordered_map<uint64_t, SectionData> pending_sections_;
+    std::string pending_title_;
+
+    // Worker thread only; both survive between renders
+    DocumentModel model_;
+    FragmentCache cache_;
+    std::thread worker_;  // Started last, after every member it uses
+
+    void workerLoop();
+    void applyChanges(const std::vector<uint64_t>& order, std::unordered_map<uint64_t, SectionData> changed);
+};
+
+#endif // PREVIEW_RENDERER_H
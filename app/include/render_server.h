@@ -0,0 +1,116 @@
+// =====================
+// RenderServer.h
+// =====================
+// Local render daemon on a Unix domain socket (no GTK):
+//   docgen serve --socket PATH [--jobs N]
+//   docgen render --socket PATH --format=adoc|md|html FILE   (client)
+//
+// A connection carries any number of requests, answered in turn:
+//   "<format> path <set path>\n"           a .docgenset the server reads
+//   "<format> content <byte count>\n<data>" set file contents sent inline
+// where <format> is adoc, md or html. Each answer is either
+//   "ok <byte count>\n<document>" or "error <message>\n".
+// Set paths are taken as given, relative to the server's working directory.
+//
+// Parsed sets and their rendered fragments stay in memory (see WarmSet); a
+// path is reloaded only when the file changes. Both kinds of set are capped,
+// so a daemon serving many distinct sets keeps only the most recent ones. Clients are served by a fixed
+// pool of threads, one connection per thread at a time.
+// =====================
+
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "export_job.h"
+#include "warm_set.h"
+
+class RenderServer {
+public:
+    explicit RenderServer(size_t jobs = 0); // Worker threads, 0 = one per hardware thread
+    ~RenderServer();
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+
+    // ----- Service -----
+    // Binds the socket, replacing a stale one; fails if a server already
+    // answers there
+    bool listen(const std::string& socket_path, std::string& error);
+    // Accepts clients until stop(), then removes the socket. Failed accepts
+    // are retried after a pause and reported to log, if given.
+    void serve(std::ostream* log = nullptr);
+    void stop();  // Any thread; open connections are closed
+    size_t acceptErrors() const { return accept_errors_; } // Failed accepts so far
+    size_t pathSetCount();                                   // Path sets currently kept warm
+    bool hasPathSet(const std::string& path);
+
+    // ----- Requests -----
+    // Renders one request; false with an error message on failure
+    bool handle(std::string_view line, std::string_view content, std::string& document, std::string& error);
+    // Content byte count of a request line, or 0 for a path request
+    static bool contentLength(std::string_view line, size_t& length);
+
+    // ----- Client -----
+    static bool request(const std::string& socket_path, const std::string& line, std::string_view content,
+                        std::string& document, std::string& error);
+
+    // The "serve" and "render" commands; return the process exit status
+    static int main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err);
+    static int clientMain(const std::vector<std::string>& args, std::ostream& out, std::ostream& err);
+
+    static constexpr size_t kMaxContentSets = 64;        // Inline sets kept warm, oldest dropped first
+    static constexpr size_t kMaxPathSets = 256;          // Path sets kept warm, least recently used dropped first
+    static constexpr size_t kMaxLineBytes = 4096;
+    static constexpr size_t kMaxContentBytes = 1u << 30;
+    static constexpr std::chrono::milliseconds kAcceptBackoff{50}; // Pause after a failed accept
+
+private:
+    struct CachedSet {
+        std::mutex mutex; // Held while the set is reloaded or rendered
+        WarmSet set;
+    };
+
+    size_t jobs_;
+    int listen_fd_ = -1;
+    std::string socket_path_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<size_t> accept_errors_{0};
+
+    std::mutex cache_mutex_;
+    struct PathSet {
+        std::shared_ptr<CachedSet> set;
+        std::list<std::string>::iterator order;
+    };
+    std::map<std::string, PathSet> path_sets_;
+    std::list<std::string> path_order_; // Least recently used first
+    std::map<uint64_t, std::shared_ptr<CachedSet>> content_sets_; // Content hash -> set
+    std::deque<uint64_t> content_order_;                           // Oldest first
+
+    std::mutex clients_mutex_;
+    std::condition_variable clients_ready_;
+    std::deque<int> waiting_clients_;
+    std::set<int> open_clients_;
+
+    void workerLoop();
+    void serveClient(int fd);
+    std::shared_ptr<CachedSet> setForPath(const std::string& path);
+    void dropPathSet(const std::string& path, const std::shared_ptr<CachedSet>& set);
+    std::shared_ptr<CachedSet> findContentSet(uint64_t hash);
+    std::shared_ptr<CachedSet> addContentSet(uint64_t hash, std::shared_ptr<CachedSet> set);
+};
+
+#endif // RENDER_SERVER_H
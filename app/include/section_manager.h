@@ -13,6 +13,10 @@
 #include <memory>
 #include <string>
 #include <functional>
+#include <unordered_map>
+#include "document_model.h"
+#include "fragment_cache.h"
+#include "set_file.h"
 
 class TextSection;
 
@@ -22,9 +26,33 @@ public:
     SectionManager(GtkWidget* text_container, GtkWidget* order_box);
     ~SectionManager();
 
+    // ----- Batched Updates -----
+    // Between beginUpdate() and commitUpdate() change notifications are held
+    // back and the section containers stay hidden; the outermost commit shows
+    // them again and fires at most one notification. Scopes nest.
+    void beginUpdate();
+    void commitUpdate();
+
+    class UpdateScope {
+    public:
+        explicit UpdateScope(SectionManager& manager) : manager_(manager) { manager_.beginUpdate(); }
+        ~UpdateScope() { manager_.commitUpdate(); }
+        UpdateScope(const UpdateScope&) = delete;
+        UpdateScope& operator=(const UpdateScope&) = delete;
+
+    private:
+        SectionManager& manager_;
+    };
+
     // ----- Content Change Callbacks -----
+    // Notifications are coalesced: the callback runs at most once per frame
+    // (or once per debounce interval when a delay is set) from the main loop.
     void setOnContentChangedCallback(std::function<void()> callback);
     void notifyContentChanged();
+    void flushContentChanged(); // Run a pending notification now
+    void setNotifyDelay(guint milliseconds); // 0 = next frame; otherwise debounce
+    void onSectionEdited(TextSection* section); // Sync headline/level/type into model
+    void onSectionContentEdited(TextSection* section); // Sync content into model
 
     // ----- Section Operations -----
     void addSection(const std::string& header, const std::string& content = std::string());
@@ -41,9 +69,12 @@ public:
     bool hasContent() const;
     std::string getLoadedDocumentTitle() const;
     TextSection* getSectionAt(size_t index) const;
+    TextSection* findSection(uint64_t id) const;
+    const DocumentModel& getModel() const;
 
     // ----- Save/Load Operations -----
-    bool saveToFile(const std::string& filepath) const;
+    bool saveToFile(const std::string& filepath, const std::string& document_title = "",
+                    SetFormat format = SetFormat::V2) const;
     bool loadFromFile(const std::string& filepath);
 
     // ----- Section Data Access -----
@@ -52,13 +83,22 @@ public:
     // ----- Document Generation -----
     std::string generateAsciiDoc(const std::string& title = "") const;
     std::string generateMarkdown(const std::string& title = "") const;
+    std::string generateHtml(const std::string& title = "") const; // Preview page
+    bool exportAsciiDoc(const std::string& filepath, const std::string& title = "") const; // Streams to file
+    bool exportMarkdown(const std::string& filepath, const std::string& title = "") const;
 
 private:
     GtkWidget* text_container_;
     GtkWidget* order_box_;
     
+    // Section views, kept in the same (display) order as model_
     std::vector<std::unique_ptr<TextSection>> sections_;
-    int section_counter_;
+    DocumentModel model_;
+    mutable FragmentCache fragment_cache_; // Rendered sections, reused until edited
+    
+    // O(1) lookup from section ID and from container/order button widget
+    std::unordered_map<uint64_t, TextSection*> sections_by_id_;
+    std::unordered_map<GtkWidget*, TextSection*> sections_by_widget_;
     
     // Main section widgets
     GtkWidget* main_section_;
@@ -73,8 +113,27 @@ private:
     // Callback for content changes
     std::function<void()> on_content_changed_;
     
+    // Coalesced notification state
+    guint notify_delay_ms_ = 0;
+    guint notify_source_id_ = 0;
+    guint notify_tick_id_ = 0;
+    GtkWidget* frame_widget_ = nullptr; // Weak pointer to text_container_ for tick callbacks
+    
+    // Batched update state
+    int update_depth_ = 0;
+    bool update_changed_ = false;
+    bool hidden_text_container_ = false;
+    bool hidden_order_box_ = false;
+    
     void createMainSection();
+    void scheduleNotify();
+    void cancelScheduledNotify();
+    void fireContentChanged();
     void setupDragAndDrop(GtkWidget* order_button, int position);
+    TextSection* addSectionFromData(SectionData data);
+    int indexOf(const TextSection* section) const;
+    TextSection* sectionForWidget(GtkWidget* widget) const;
+    void unindexSection(TextSection* section);
     
     // Drag and drop callbacks
     static void onDragBegin(GtkWidget* widget, GdkDragContext* context, gpointer user_data);
@@ -91,6 +150,10 @@ private:
     static void onDragEnd(GtkWidget* widget, GdkDragContext* context, gpointer user_data);
     static gboolean onOrderBoxDragMotion(GtkWidget* widget, GdkDragContext* context,
                                          gint x, gint y, guint time, gpointer user_data);
+    
+    // Coalesced notification callbacks
+    static gboolean onNotifyTick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data);
+    static gboolean onNotifySource(gpointer user_data);
 };
 
 #endif // SECTION_MANAGER_H
@@ -0,0 +1,104 @@
+// =====================
+// SetFile.h
+// =====================
+// Reading and writing of .docgenset section set files (no GTK).
+// Files are memory-mapped and tokenized in place with string_view;
+// loaded section bodies stay in the mapping until something needs them.
+//
+// Two on-disk formats are supported:
+//  - v1: the original [SECTION:]/[END_SECTION] text format
+//  - v2: an indexed format with a header, a section offset/length table
+//        and length-prefixed fields, so section N can be read directly
+//        and content may contain any text (including "[END_SECTION]").
+// =====================
+
+#ifndef SET_FILE_H
+#define SET_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document_model.h"
+#include "file_sink.h"
+
+// ----- Read-only Memory Mapping -----
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filepath); // False if the file cannot be opened or mapped
+    void close();
+    std::string_view data() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+};
+
+// ----- Parsed Set Contents -----
+struct ParsedSet {
+    std::string document_title;
+    std::vector<SectionData> sections;
+};
+
+enum class SetFormat { V1, V2 };
+
+// ----- v2 Random Access -----
+// Fields of one v2 section, pointing into the file data
+struct SectionView {
+    std::string_view header;
+    std::string_view headline;
+    int level = 1;
+    std::string_view type;
+    std::string_view content;
+};
+
+class SetIndexReader {
+public:
+    bool open(std::string_view data); // Validates header and offset table
+    std::string_view documentTitle() const { return title_; }
+    size_t size() const { return count_; }
+    bool section(size_t index, SectionView& out) const; // False if the record is corrupt
+
+private:
+    std::string_view data_;
+    std::string_view title_;
+    size_t count_ = 0;
+    size_t table_offset_ = 0;
+};
+
+class SetFile {
+public:
+    // ----- Loading -----
+    // load() keeps the mapping alive through the sections' content_owner and
+    // leaves their bodies as lazy views into it.
+    // With an owner, parse() does the same for data that owner keeps alive;
+    // without one, bodies are copied.
+    // Large inputs are parsed on up to `jobs` threads (0 = one per core);
+    // sections always come back in file order.
+    using Owner = std::shared_ptr<const void>;
+    static bool load(const std::string& filepath, ParsedSet& out, size_t jobs = 0);
+    static bool parse(std::string_view data, ParsedSet& out, const Owner& owner = nullptr,
+                      size_t jobs = 0); // Detects the format
+    static bool isIndexed(std::string_view data); // True for v2 data
+    static void parseV1(std::string_view data, ParsedSet& out, const Owner& owner = nullptr, size_t jobs = 0);
+    static bool parseV2(std::string_view data, ParsedSet& out, const Owner& owner = nullptr, size_t jobs = 0);
+
+    // ----- Saving -----
+    // Writes to a temporary file and renames it over filepath, so a mapping
+    // of the previous file (still referenced by lazy sections) stays valid.
+    static bool save(const std::string& filepath, const DocumentModel& model,
+                     const std::string& document_title, SetFormat format = SetFormat::V2);
+    // Section fields are passed to out by reference; model must stay
+    // unchanged until out is committed
+    static void writeV1(FileSink& out, const DocumentModel& model, const std::string& document_title);
+    static void writeV2(FileSink& out, const DocumentModel& model, const std::string& document_title);
+};
+
+#endif // SET_FILE_H
@@ -9,6 +9,7 @@
 #define TEXT_SECTION_H
 
 #include <gtk/gtk.h>
+#include <cstdint>
 #include <string>
 
 class SectionManager;
@@ -23,10 +24,13 @@ public:
     GtkWidget* getContainer() const; // Main section container
     GtkWidget* getOrderButton() const; // Order button widget
     int getPosition() const; // Section position
+    uint64_t getId() const { return id_; } // Stable section ID in the document model
     std::string getHeader() const; // Section header
     std::string getHeadline() const; // Headline text
     int getHeadlineLevel() const; // Headline level (I/II/III)
     std::string getSectionType() const; // Section type (text/quote/box)
+    std::string getContent() const; // Section content (from the model while still pending)
+    bool isContentPending() const { return content_pending_; } // Body not yet in the text buffer
 
     // ----- Data Setters -----
     void setHeader(const std::string& header); // Set section header
@@ -36,6 +40,9 @@ public:
     void setHeadlineLevel(int level); // Set headline level
     void setSectionType(const std::string& type); // Set section type
     void setManager(SectionManager* manager) { manager_ = manager; } // Set parent manager
+    void setId(uint64_t id) { id_ = id; } // Bind to a document model section
+    void setContentPending(); // Fill the text buffer from the model when first drawn
+    void ensureContentLoaded(); // Fill a pending text buffer now
 
     // ----- UI Visibility -----
     void show(); // Show section UI
@@ -44,6 +51,9 @@ public:
 private:
     // ----- Data Members -----
     int position_;
+    uint64_t id_ = 0;
+    bool content_pending_ = false;
+    guint load_idle_id_ = 0;
     std::string header_text_;
     SectionManager* manager_;
 
@@ -73,6 +83,9 @@ private:
     static void onTypeRadioChanged(GtkToggleButton* button, gpointer user_data);
     static void onDeleteClicked(GtkButton* button, gpointer user_data);
     static void onHeadlineChanged(GtkEditable* editable, gpointer user_data);
+    static void onContentChanged(GtkTextBuffer* buffer, gpointer user_data);
+    static gboolean onTextViewDraw(GtkWidget* widget, cairo_t* cr, gpointer user_data);
+    static gboolean onLoadContentIdle(gpointer user_data);
 
     // ----- UI Helpers -----
     void updateLevelIndicator(); // Update I/II/III indicator
@@ -0,0 +1,56 @@
+// =====================
+// WarmSet.h
+// =====================
+// One section set kept in memory between renders (no GTK), for the
+// long-running command-line modes. The model and its FragmentCache survive
+// reloads: a reloaded section that hashes the same as an old one takes over
+// its ID, so only new or edited sections are rendered again. Old sections are
+// matched by the hashes taken when they were loaded, never by reading their
+// bodies again: the file they map may have been rewritten in place.
+// =====================
+
+#ifndef WARM_SET_H
+#define WARM_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "document_model.h"
+#include "export_job.h"
+#include "fragment_cache.h"
+#include "set_file.h"
+
+class WarmSet {
+public:
+    // ----- Contents -----
+    // Reloads from filepath unless the file is unchanged (same inode, size
+    // and mtime) since the last load; false if it cannot be loaded
+    bool load(const std::string& filepath, size_t jobs = 0);
+    bool parse(std::string_view data); // Set file contents; bodies are copied
+    void update(ParsedSet parsed);
+
+    const DocumentModel& model() const { return model_; }
+    const std::string& title() const { return title_; }
+    uint64_t contentHash() const { return content_hash_; } // Title plus all section hashes
+
+    // ----- Rendering -----
+    std::string render(ExportFormat format);
+    size_t renderCount() const { return cache_.renderCount(); }
+
+private:
+    DocumentModel model_;
+    std::vector<uint64_t> section_hashes_; // Hash of each section in model_, taken when it was loaded
+    std::string title_;
+    FragmentCache cache_;
+    uint64_t content_hash_ = 0;
+    uint64_t next_id_ = 1; // Section IDs are never reused, so stale cache entries cannot match
+
+    // Identity of the file last loaded
+    uint64_t file_inode_ = 0;
+    uint64_t file_size_ = 0;
+    int64_t file_mtime_ns_ = -1;
+};
+
+#endif // WARM_SET_H
@@ -0,0 +1,56 @@
+// =====================
+// WatchExport.h
+// =====================
+// Watch mode for the command line (no GTK; the loop uses GIO):
+//   docgen watch --format=adoc|md|html [--jobs N] -o DIR SETDIR
+// Exports every .docgenset in SETDIR, then re-exports a set whenever it
+// changes. Each set stays in memory as a WarmSet, so a rebuild only
+// re-renders the sections that were edited.
+// =====================
+
+#ifndef WATCH_EXPORT_H
+#define WATCH_EXPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "batch_export.h"
+#include "export_manifest.h"
+#include "warm_set.h"
+
+class WatchExport {
+public:
+    explicit WatchExport(BatchOptions options);
+
+    // Re-exports the given sets, several at a time. A set that no longer
+    // exists is forgotten and the output written for it deleted. Results
+    // come back in the order given.
+    std::vector<BatchResult> rebuild(const std::vector<std::string>& set_paths);
+    size_t setCount() const { return sets_.size(); }
+    size_t renderCount() const; // Fragments rendered so far, over all sets
+
+    static std::vector<std::string> listSets(const std::string& dir); // Sorted *.docgenset paths
+
+    // The whole "watch" command; runs until interrupted
+    static int main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err);
+    static const char* usage();
+
+    static constexpr unsigned kDebounceMs = 50; // Quiet time after the last event before a rebuild
+
+private:
+    struct WatchedSet {
+        WarmSet set;
+        ExportManifest written; // The output file as last written
+    };
+
+    BatchOptions options_;
+    std::map<std::string, std::unique_ptr<WatchedSet>> sets_; // Set path -> state
+
+    BatchResult rebuildSet(const std::string& path, WatchedSet& watched, size_t jobs);
+};
+
+#endif // WATCH_EXPORT_H
@@ -0,0 +1,278 @@
+// =====================
+// BatchExport.cpp
+// =====================
+// Implements the headless command-line export
+// =====================
+
+#include "batch_export.h"
+#include "book_file.h"
+#include "parallel.h"
+#include "set_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <sys/stat.h>
+
+namespace {
+
+bool parseFormat(const std::string& name, ExportFormat& format) {
+    if (name == "adoc" || name == "asciidoc") {
+        format = ExportFormat::AsciiDoc;
+    } else if (name == "md" || name == "markdown") {
+        format = ExportFormat::Markdown;
+    } else if (name == "html") {
+        format = ExportFormat::Html;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* extensionFor(ExportFormat format) {
+    switch (format) {
+        case ExportFormat::AsciiDoc: return ".adoc";
+        case ExportFormat::Markdown: return ".md";
+        case ExportFormat::Html: return ".html";
+    }
+    return "";
+}
+
+bool hasSuffix(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Creates dir (and missing parents); an existing directory is fine
+bool makeDirectories(const std::string& dir) {
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+        std::string part = dir.substr(0, slash);
+        if (!part.empty() && mkdir(part.c_str(), 0777) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+    struct stat st;
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+BatchResult exportOne(const BatchOptions& options, const std::string& input, const std::string& output,
+                      size_t jobs) {
+    BatchResult result;
+    result.input = input;
+    result.output = output;
+    auto start = std::chrono::steady_clock::now();
+
+    DocumentModel model;
+    std::string title;
+    bool is_book = BookFile::isBookPath(input);
+    if (!is_book) {
+        ParsedSet parsed;
+        if (!SetFile::load(input, parsed, jobs)) {
+            result.error = "cannot load section set";
+        } else {
+            title = std::move(parsed.document_title);
+            for (auto& section : parsed.sections) {
+                model.append(std::move(section));
+            }
+        }
+    }
+
+    if (result.error.empty()) {
+        ExportJob job(std::move(model), std::move(title), output, options.format, jobs);
+        if (is_book) {
+            job.setBookSource(input); // Assembled by the job itself
+        }
+        job.setIncremental(options.incremental);
+        result.ok = job.run() == ExportJob::Status::Done;
+        result.skipped = job.filesSkipped() > 0 && job.filesWritten() == 0;
+        result.sections = job.sectionCount();
+        if (!result.ok) {
+            result.error = job.error().empty() ? "cannot write " + output : job.error();
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    result.milliseconds = elapsed.count();
+    return result;
+}
+
+} // namespace
+
+// ----- Arguments -----
+bool BatchExport::parseArguments(const std::vector<std::string>& args, BatchOptions& out, std::string& error) {
+    out = BatchOptions();
+    bool has_format = false;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+
+        // Options take "--name=value" or "--name value"
+        std::string name = arg;
+        std::string value;
+        bool has_value = false;
+        size_t equals = arg.find('=');
+        if (arg.compare(0, 2, "--") == 0 && equals != std::string::npos) {
+            name = arg.substr(0, equals);
+            value = arg.substr(equals + 1);
+            has_value = true;
+        }
+        auto takeValue = [&]() {
+            if (!has_value && i + 1 < args.size()) {
+                value = args[++i];
+                has_value = true;
+            }
+            if (!has_value) {
+                error = "missing value for " + name;
+            }
+            return has_value;
+        };
+
+        if (name == "--format" || name == "-f") {
+            if (!takeValue()) return false;
+            if (!parseFormat(value, out.format)) {
+                error = "unknown format: " + value;
+                return false;
+            }
+            has_format = true;
+        } else if (name == "--jobs" || name == "-j") {
+            if (!takeValue()) return false;
+            char* end = nullptr;
+            unsigned long jobs = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || value[0] == '-') {
+                error = "invalid job count: " + value;
+                return false;
+            }
+            out.jobs = static_cast<size_t>(jobs);
+        } else if (name == "--output" || name == "-o") {
+            if (!takeValue()) return false;
+            out.output_dir = value;
+        } else if (name == "--incremental") {
+            out.incremental = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            error = "unknown option: " + arg;
+            return false;
+        } else {
+            out.inputs.push_back(arg);
+        }
+    }
+
+    if (!has_format) {
+        error = "--format is required";
+    } else if (out.output_dir.empty()) {
+        error = "-o is required";
+    } else if (out.inputs.empty()) {
+        error = "no input files";
+    }
+    return error.empty();
+}
+
+std::string BatchExport::outputPath(const BatchOptions& options, const std::string& input) {
+    size_t slash = input.find_last_of('/');
+    std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+    for (const char* extension : {".docgenset", ".docgenbook"}) {
+        if (hasSuffix(name, extension)) {
+            name.resize(name.size() - std::char_traits<char>::length(extension));
+            break;
+        }
+    }
+    std::string dir = options.output_dir;
+    if (!dir.empty() && dir.back() != '/') {
+        dir += '/';
+    }
+    return dir + name + extensionFor(options.format);
+}
+
+// ----- Export -----
+std::vector<BatchResult> BatchExport::run(const BatchOptions& options,
+                                          const std::function<void(const BatchResult&)>& on_done) {
+    std::vector<BatchResult> results(options.inputs.size());
+    std::mutex report_mutex;
+    auto report = [&](const BatchResult& result) {
+        if (on_done) {
+            std::lock_guard<std::mutex> lock(report_mutex);
+            on_done(result);
+        }
+    };
+
+    // Two inputs with the same name would race for one output file; the
+    // first one wins
+    std::vector<std::string> outputs(options.inputs.size());
+    std::vector<char> duplicate(options.inputs.size(), 0);
+    std::map<std::string, size_t> first_input;
+    for (size_t i = 0; i < options.inputs.size(); ++i) {
+        outputs[i] = outputPath(options, options.inputs[i]);
+        duplicate[i] = !first_input.emplace(outputs[i], i).second;
+    }
+
+    bool have_dir = makeDirectories(options.output_dir);
+
+    // Files are the unit of work; a single file gets all threads instead
+    size_t inner_jobs = options.inputs.size() == 1 ? options.jobs : 1;
+    parallelFor(options.inputs.size(), options.jobs, [&](size_t i) {
+        BatchResult& result = results[i];
+        if (!have_dir) {
+            result.input = options.inputs[i];
+            result.output = outputs[i];
+            result.error = "cannot create directory " + options.output_dir;
+        } else if (duplicate[i]) {
+            result.input = options.inputs[i];
+            result.output = outputs[i];
+            result.error = "same output as " + options.inputs[first_input[outputs[i]]];
+        } else {
+            result = exportOne(options, options.inputs[i], outputs[i], inner_jobs);
+        }
+        report(result);
+    });
+    return results;
+}
+
+// ----- Command -----
+int BatchExport::main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err) {
+    for (const std::string& arg : args) {
+        if (arg == "--help" || arg == "-h") {
+            out << usage();
+            return 0;
+        }
+    }
+
+    BatchOptions options;
+    std::string error;
+    if (!parseArguments(args, options, error)) {
+        err << "docgen export: " << error << "\n" << usage();
+        return 2;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t failed = 0;
+    size_t skipped = 0;
+    run(options, [&](const BatchResult& result) {
+        char timing[32];
+        std::snprintf(timing, sizeof(timing), "%9.1f ms  ", result.milliseconds);
+        if (!result.ok) {
+            ++failed;
+            err << timing << result.input << ": " << result.error << "\n";
+        } else {
+            skipped += result.skipped;
+            out << timing << result.input << " -> " << result.output << " (" << result.sections
+                << " sections" << (result.skipped ? ", up to date" : "") << ")\n";
+        }
+    });
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    char total[64];
+    std::snprintf(total, sizeof(total), "%.1f ms", elapsed.count());
+    out << options.inputs.size() << " files, " << failed << " failed, " << skipped << " up to date, " << total
+        << " on " << std::min(resolveJobs(options.jobs), options.inputs.size()) << " threads\n";
+    return failed == 0 ? 0 : 1;
+}
+
+const char* BatchExport::usage() {
+    return "Usage: docgen export --format=adoc|md|html [--jobs N] [--incremental] -o DIR FILE...\n"
+           "  Exports each .docgenset or .docgenbook FILE to DIR/<name>.<ext> without opening a window.\n"
+           "  --jobs N       worker threads (default: one per CPU)\n"
+           "  --incremental  leave outputs whose inputs have not changed untouched\n";
+}
@@ -0,0 +1,231 @@
+// =====================
+// BookFile.cpp
+// =====================
+// Implements .docgenbook parsing and assembly
+// =====================
+
+#include "book_file.h"
+#include "parallel.h"
+#include "set_file.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Absolute path with symlinks resolved, so one file is only ever loaded once
+bool canonicalPath(const std::string& path, std::string& out) {
+    char* resolved = realpath(path.c_str(), nullptr);
+    if (!resolved) {
+        return false;
+    }
+    out = resolved;
+    std::free(resolved);
+    return true;
+}
+
+std::string resolveInclude(const std::string& book_path, const std::string& include) {
+    if (!include.empty() && include[0] == '/') {
+        return include;
+    }
+    size_t slash = book_path.find_last_of('/');
+    return slash == std::string::npos ? include : book_path.substr(0, slash + 1) + include;
+}
+
+// One set file to append, in manifest order
+struct BookStep {
+    size_t set_index;
+    int level_offset;
+};
+
+class BookAssembler {
+public:
+    explicit BookAssembler(std::string& error) : error_(error) {}
+
+    bool flatten(const std::string& book_path, int level_offset, std::string* title) {
+        std::string canonical;
+        if (!canonicalPath(book_path, canonical)) {
+            error_ = "Cannot open book " + book_path;
+            return false;
+        }
+        if (std::find(stack_.begin(), stack_.end(), canonical) != stack_.end()) {
+            error_ = "Include cycle: ";
+            for (const auto& path : stack_) error_ += path + " -> ";
+            error_ += canonical;
+            return false;
+        }
+
+        const BookManifest* manifest = manifestFor(canonical);
+        if (!manifest) {
+            return false;
+        }
+        if (title) {
+            *title = manifest->title;
+        }
+
+        stack_.push_back(canonical);
+        for (const auto& include : manifest->includes) {
+            std::string path = resolveInclude(canonical, include.path);
+            int offset = level_offset + include.level_offset;
+            if (BookFile::isBookPath(path)) {
+                if (!flatten(path, offset, nullptr)) {
+                    return false;
+                }
+            } else if (!addSet(path, offset)) {
+                return false;
+            }
+        }
+        stack_.pop_back();
+        return true;
+    }
+
+    // Loads each distinct set once; with a single set all jobs go to its parser
+    bool loadSets(size_t jobs) {
+        sets_.resize(set_paths_.size());
+        std::vector<char> loaded(set_paths_.size(), 0);
+        size_t inner_jobs = set_paths_.size() == 1 ? jobs : 1;
+        parallelFor(set_paths_.size(), jobs, [&](size_t i) {
+            loaded[i] = SetFile::load(set_paths_[i], sets_[i], inner_jobs);
+        });
+        for (size_t i = 0; i < set_paths_.size(); ++i) {
+            if (!loaded[i]) {
+                error_ = "Cannot load section set " + set_paths_[i];
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void append(DocumentModel& out) const {
+        for (const BookStep& step : steps_) {
+            for (const SectionData& section : sets_[step.set_index].sections) {
+                SectionData copy = section; // Shares the set's mapping
+                copy.id = 0;
+                copy.level = std::clamp(copy.level + step.level_offset, 1, 3);
+                out.append(std::move(copy));
+            }
+        }
+    }
+
+    std::string firstSetTitle() const {
+        return steps_.empty() ? std::string() : sets_[steps_.front().set_index].document_title;
+    }
+
+private:
+    std::string& error_;
+    std::vector<std::string> stack_;                   // Books being flattened, outermost first
+    std::map<std::string, BookManifest> manifests_;    // Canonical path -> parsed book
+    std::map<std::string, size_t> set_indices_;        // Canonical path -> index in set_paths_
+    std::vector<std::string> set_paths_;
+    std::vector<ParsedSet> sets_;
+    std::vector<BookStep> steps_;
+
+    const BookManifest* manifestFor(const std::string& canonical) {
+        auto it = manifests_.find(canonical);
+        if (it != manifests_.end()) {
+            return &it->second;
+        }
+        std::ifstream in(canonical);
+        if (!in) {
+            error_ = "Cannot open book " + canonical;
+            return nullptr;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        BookManifest manifest;
+        std::string parse_error;
+        if (!BookFile::parse(text.str(), manifest, parse_error)) {
+            error_ = canonical + ": " + parse_error;
+            return nullptr;
+        }
+        return &manifests_.emplace(canonical, std::move(manifest)).first->second;
+    }
+
+    bool addSet(const std::string& path, int level_offset) {
+        std::string canonical;
+        if (!canonicalPath(path, canonical)) {
+            error_ = "Cannot open section set " + path;
+            return false;
+        }
+        auto inserted = set_indices_.emplace(canonical, set_paths_.size());
+        if (inserted.second) {
+            set_paths_.push_back(canonical);
+        }
+        steps_.push_back({inserted.first->second, level_offset});
+        return true;
+    }
+};
+
+} // namespace
+
+bool BookFile::parse(std::string_view text, BookManifest& out, std::string& error) {
+    out = BookManifest();
+    size_t line_number = 0;
+    while (!text.empty()) {
+        size_t newline = text.find('\n');
+        std::string_view line = trim(text.substr(0, newline));
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+        ++line_number;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        size_t colon = line.find(':');
+        std::string_view key = colon == std::string_view::npos ? line : trim(line.substr(0, colon));
+        std::string_view value = colon == std::string_view::npos ? std::string_view() : trim(line.substr(colon + 1));
+        if (key == "title") {
+            out.title = std::string(value);
+        } else if (key == "include" && !value.empty()) {
+            BookInclude include;
+            size_t option = value.rfind(" offset=");
+            if (option != std::string_view::npos) {
+                std::string number(value.substr(option + 8));
+                char* end = nullptr;
+                long offset = std::strtol(number.c_str(), &end, 10);
+                if (number.empty() || *end != '\0' || offset < INT_MIN / 2 || offset > INT_MAX / 2) {
+                    error = "line " + std::to_string(line_number) + ": invalid offset";
+                    return false;
+                }
+                include.level_offset = static_cast<int>(offset);
+                value = trim(value.substr(0, option));
+            }
+            include.path = std::string(value);
+            out.includes.push_back(std::move(include));
+        } else {
+            error = "line " + std::to_string(line_number) + ": unknown directive";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BookFile::isBookPath(const std::string& path) {
+    static const std::string extension = ".docgenbook";
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool BookFile::build(const std::string& filepath, DocumentModel& out, std::string& title,
+                     std::string& error, size_t jobs) {
+    BookAssembler assembler(error);
+    std::string book_title;
+    if (!assembler.flatten(filepath, 0, &book_title) || !assembler.loadSets(jobs)) {
+        return false;
+    }
+    out.clear();
+    assembler.append(out);
+    title = book_title.empty() ? assembler.firstSetTitle() : book_title;
+    return true;
+}
@@ -0,0 +1,87 @@
+// =====================
+// DocumentModel.cpp
+// =====================
+// Implements the headless document model and generators
+// =====================
+
+#include "document_model.h"
+#include "document_writer.h"
+#include <utility>
+
+// ----- ID Lookup -----
+int DocumentModel::indexOf(uint64_t id) const {
+    auto it = index_.find(id);
+    return it != index_.end() ? static_cast<int>(it->second) : -1;
+}
+
+SectionData* DocumentModel::find(uint64_t id) {
+    auto it = index_.find(id);
+    return it != index_.end() ? &sections_[it->second] : nullptr;
+}
+
+const SectionData* DocumentModel::find(uint64_t id) const {
+    auto it = index_.find(id);
+    return it != index_.end() ? &sections_[it->second] : nullptr;
+}
+
+// ----- Section Operations -----
+size_t DocumentModel::append(SectionData section) {
+    if (section.id == 0 || index_.count(section.id)) {
+        section.id = next_id_++;
+    } else if (section.id >= next_id_) {
+        next_id_ = section.id + 1;
+    }
+    index_[section.id] = sections_.size();
+    sections_.push_back(std::move(section));
+    return sections_.size() - 1;
+}
+
+void DocumentModel::erase(size_t index) {
+    if (index < sections_.size()) {
+        index_.erase(sections_[index].id);
+        sections_.erase(sections_.begin() + index);
+        reindexFrom(index);
+    }
+}
+
+bool DocumentModel::reorder(const std::vector<size_t>& order) {
+    if (order.size() != sections_.size()) {
+        return false;
+    }
+    // Every old index exactly once, or sections would be lost or duplicated
+    std::vector<bool> seen(order.size(), false);
+    for (size_t old_index : order) {
+        if (old_index >= order.size() || seen[old_index]) {
+            return false;
+        }
+        seen[old_index] = true;
+    }
+    std::vector<SectionData> reordered;
+    reordered.reserve(sections_.size());
+    for (size_t old_index : order) {
+        reordered.push_back(std::move(sections_[old_index]));
+    }
+    sections_ = std::move(reordered);
+    reindexFrom(0);
+    return true;
+}
+
+void DocumentModel::clear() {
+    sections_.clear();
+    index_.clear();
+}
+
+void DocumentModel::reindexFrom(size_t start) {
+    for (size_t i = start; i < sections_.size(); ++i) {
+        index_[sections_[i].id] = i;
+    }
+}
+
+// ----- Document Generation -----
+std::string DocumentModel::generateAsciiDoc(const std::string& title) const {
+    return DocumentWriter<AsciiDocFormat>::render(*this, title);
+}
+
+std::string DocumentModel::generateMarkdown(const std::string& title) const {
+    return DocumentWriter<MarkdownFormat>::render(*this, title);
+}
@@ -0,0 +1,408 @@
+// =====================
+// ExportJob.cpp
+// =====================
+// Implements background document export
+// =====================
+
+#include "export_job.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include "book_file.h"
+#include "content_hash.h"
+#include "document_writer.h"
+#include "file_sink.h"
+#include "html_renderer.h"
+#include "parallel.h"
+
+namespace {
+
+// Label of a chapter in a Markdown index
+std::string_view chapterLabel(const SectionData& first) {
+    return first.headline.empty() ? std::string_view(first.header) : std::string_view(first.headline);
+}
+
+std::string_view baseName(std::string_view path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string_view::npos ? path : path.substr(slash + 1);
+}
+
+// An AsciiDoc index includes the chapters, so it still renders as one book
+void appendIndexEntry(AsciiDocFormat, size_t, std::string_view, std::string_view file, std::string& out) {
+    out += "include::";
+    out += file;
+    out += "[]\n\n";
+}
+
+void appendIndexEntry(MarkdownFormat, size_t number, std::string_view label, std::string_view file,
+                      std::string& out) {
+    out += std::to_string(number);
+    out += ". [";
+    out += label;
+    out += "](";
+    out += file;
+    out += ")\n";
+}
+
+} // namespace
+
+// ----- Chapters -----
+std::vector<ChapterRange> splitChapters(const DocumentModel& model) {
+    std::vector<ChapterRange> chapters;
+    const auto& sections = model.sections();
+    for (size_t i = 0; i < sections.size(); ++i) {
+        bool starts_chapter = sections[i].level == 1 && !sections[i].headline.empty();
+        if (chapters.empty() || starts_chapter) {
+            chapters.push_back({i, i + 1});
+        } else {
+            chapters.back().last = i + 1;
+        }
+    }
+    return chapters;
+}
+
+std::string chapterFilePath(const std::string& index_path, size_t chapter, size_t count) {
+    size_t dot = index_path.find_last_of('.');
+    size_t slash = index_path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = index_path.size();
+    }
+    int width = std::max<int>(2, static_cast<int>(std::to_string(count).size()));
+    char number[32];
+    std::snprintf(number, sizeof(number), "-%0*zu", width, chapter + 1);
+    return index_path.substr(0, dot) + number + index_path.substr(dot);
+}
+
+// ----- Export -----
+ExportJob::ExportJob(DocumentModel snapshot, std::string title, std::string filepath, ExportFormat format,
+                     size_t jobs)
+    : ExportJob(std::move(snapshot), std::move(title), {ExportTarget{format, std::move(filepath)}}, jobs) {
+}
+
+ExportJob::ExportJob(DocumentModel snapshot, std::string title, std::vector<ExportTarget> targets, size_t jobs)
+    : model_(std::move(snapshot)), title_(std::move(title)), targets_(std::move(targets)), jobs_(jobs),
+      sections_total_(model_.size()) {
+}
+
+ExportJob::Status ExportJob::run() {
+    sections_done_ = 0;
+    files_written_ = 0;
+    files_skipped_ = 0;
+    error_.clear();
+    if (!book_path_.empty()) {
+        std::string book_title;
+        if (!BookFile::build(book_path_, model_, book_title, error_, jobs_)) {
+            return Status::Failed;
+        }
+        if (title_.empty()) {
+            title_ = std::move(book_title);
+        }
+        sections_total_ = model_.size();
+    }
+    if (cancelled_) {
+        return Status::Cancelled;
+    }
+    prepareManifest();
+    return finishManifest(writeTargets());
+}
+
+ExportJob::Status ExportJob::writeTargets() {
+    if (targets_.size() == 1) {
+        const ExportTarget& target = targets_.front();
+        if (target.split_chapters && target.format == ExportFormat::AsciiDoc) {
+            return writeChapters<AsciiDocFormat>(target);
+        }
+        if (target.split_chapters && target.format == ExportFormat::Markdown) {
+            return writeChapters<MarkdownFormat>(target);
+        }
+        if (target.format == ExportFormat::AsciiDoc) {
+            return writeParallel<AsciiDocFormat>(target);
+        }
+        if (target.format == ExportFormat::Markdown) {
+            return writeParallel<MarkdownFormat>(target);
+        }
+    }
+    return writeSinglePass();
+}
+
+double ExportJob::progress() const {
+    size_t total = sections_total_;
+    return total == 0 ? 1.0 : static_cast<double>(sections_done_) / static_cast<double>(total);
+}
+
+template <typename Format>
+ExportJob::Status ExportJob::writeParallel(const ExportTarget& target) {
+    using Writer = DocumentWriter<Format>;
+    const auto& sections = model_.sections();
+    const std::string& filepath = target.filepath;
+    uint64_t input_hash = rangeHash(target.format, 0, sections.size(), true);
+    if (skipIfCurrent(filepath, input_hash)) {
+        sections_done_ = sections.size();
+        return Status::Done;
+    }
+
+    // Every section's place in the file is known up front, so blocks of
+    // sections can be rendered and written out of order
+    std::vector<size_t> offsets = Writer::sectionOffsets(model_, title_, jobs_);
+    FileSink sink;
+    if (!sink.open(filepath, offsets.back())) {
+        return Status::Failed;
+    }
+
+    std::string head;
+    Writer::appendTitle(title_, head);
+    sink.writeAt(0, head);
+    Writer::forEachBlock(sections.size(), jobs_, [&](size_t first, size_t last) {
+        if (cancelled_ || !sink.ok()) {
+            return; // commit() reports a write error
+        }
+        FileRangeWriter out(sink, offsets[first]);
+        for (size_t i = first; i < last; ++i) {
+            Writer::writeSection(out, sections[i]);
+        }
+        out.flush();
+        sections_done_ += last - first;
+    });
+
+    if (cancelled_) {
+        sink.abort(); // The target file is left untouched
+        return Status::Cancelled;
+    }
+    if (!sink.commit()) {
+        return Status::Failed;
+    }
+    recordWritten(filepath, input_hash);
+    return Status::Done;
+}
+
+template <typename Format>
+ExportJob::Status ExportJob::writeChapters(const ExportTarget& target) {
+    using Writer = DocumentWriter<Format>;
+    const auto& sections = model_.sections();
+    const std::string& index_path = target.filepath;
+    std::vector<ChapterRange> chapters = splitChapters(model_);
+
+    // Unchanged chapter files are left alone
+    std::vector<uint64_t> chapter_hashes(chapters.size());
+    std::vector<char> skipped(chapters.size());
+    for (size_t c = 0; c < chapters.size(); ++c) {
+        chapter_hashes[c] = rangeHash(target.format, chapters[c].first, chapters[c].last, false);
+        skipped[c] = skipIfCurrent(chapterFilePath(index_path, c, chapters.size()), chapter_hashes[c]);
+        if (skipped[c]) {
+            sections_done_ += chapters[c].last - chapters[c].first;
+        }
+    }
+
+    // Chapters are independent files, so they are written concurrently;
+    // each one is committed as soon as it is complete
+    std::atomic<bool> failed{false};
+    parallelFor(chapters.size(), jobs_, [&](size_t c) {
+        if (skipped[c] || cancelled_ || failed) {
+            return;
+        }
+        const ChapterRange& chapter = chapters[c];
+        size_t size = 0;
+        for (size_t i = chapter.first; i < chapter.last; ++i) {
+            size += Writer::measureSection(sections[i]);
+        }
+        FileSink sink;
+        if (!sink.open(chapterFilePath(index_path, c, chapters.size()), size)) {
+            failed = true;
+            return;
+        }
+        for (size_t i = chapter.first; i < chapter.last; ++i) {
+            if (cancelled_) {
+                return; // The sink discards its temporary file
+            }
+            Writer::writeSection(sink, sections[i]);
+            ++sections_done_;
+        }
+        if (!sink.commit()) {
+            failed = true;
+        }
+    });
+    if (cancelled_) {
+        return Status::Cancelled;
+    }
+    if (failed) {
+        return Status::Failed;
+    }
+    for (size_t c = 0; c < chapters.size(); ++c) {
+        if (!skipped[c]) {
+            recordWritten(chapterFilePath(index_path, c, chapters.size()), chapter_hashes[c]);
+        }
+    }
+
+    // The index goes last, so it only ever lists complete chapters
+    std::string index;
+    Writer::appendTitle(title_, index);
+    for (size_t c = 0; c < chapters.size(); ++c) {
+        std::string file = chapterFilePath(index_path, c, chapters.size());
+        appendIndexEntry(Format(), c + 1, chapterLabel(sections[chapters[c].first]), baseName(file), index);
+    }
+    uint64_t index_hash = hashBytes(index, hashValue(static_cast<uint64_t>(target.format), kHashSeed));
+    if (skipIfCurrent(index_path, index_hash)) {
+        return Status::Done;
+    }
+    FileSink sink;
+    if (!sink.open(index_path, index.size())) {
+        return Status::Failed;
+    }
+    sink.append(index);
+    if (!sink.commit()) {
+        return Status::Failed;
+    }
+    recordWritten(index_path, index_hash);
+    return Status::Done;
+}
+
+ExportJob::Status ExportJob::writeSinglePass() {
+    // At most one sink per format; up-to-date targets get none
+    std::unique_ptr<FileSink> sinks[3];
+    uint64_t input_hashes[3] = {0, 0, 0};
+    const ExportTarget* written[3] = {nullptr, nullptr, nullptr};
+    for (const ExportTarget& target : targets_) {
+        int slot = static_cast<int>(target.format);
+        input_hashes[slot] = rangeHash(target.format, 0, model_.size(), true);
+        if (skipIfCurrent(target.filepath, input_hashes[slot])) {
+            continue;
+        }
+        sinks[slot] = std::make_unique<FileSink>();
+        written[slot] = &target;
+        if (!sinks[slot]->open(target.filepath)) {
+            return Status::Failed;
+        }
+    }
+    if (!written[0] && !written[1] && !written[2]) {
+        sections_done_ = model_.size();
+        return Status::Done;
+    }
+    FileSink* asciidoc = sinks[static_cast<int>(ExportFormat::AsciiDoc)].get();
+    FileSink* markdown = sinks[static_cast<int>(ExportFormat::Markdown)].get();
+    FileSink* html = sinks[static_cast<int>(ExportFormat::Html)].get();
+
+    // Every sink is written straight from the section data; section text is
+    // owned by model_, so large pieces can be referenced until the commit
+    if (asciidoc) {
+        DocumentWriter<AsciiDocFormat>::writeTitle(*asciidoc, title_);
+    }
+    if (markdown) {
+        DocumentWriter<MarkdownFormat>::writeTitle(*markdown, title_);
+    }
+    if (html) {
+        html->append(htmlDocumentHead());
+        HtmlWriter::writeTitle(*html, title_);
+    }
+
+    for (const auto& section : model_.sections()) {
+        if (cancelled_) {
+            return Status::Cancelled; // The sinks discard their temporary files
+        }
+        if (asciidoc) {
+            DocumentWriter<AsciiDocFormat>::writeSection(*asciidoc, section);
+        }
+        if (markdown) {
+            DocumentWriter<MarkdownFormat>::writeSection(*markdown, section);
+        }
+        if (html) {
+            HtmlWriter::writeSection(*html, section);
+        }
+        ++sections_done_;
+    }
+
+    if (html) {
+        html->append(htmlPageTail());
+    }
+    bool committed = true;
+    for (int slot = 0; slot < 3; ++slot) {
+        if (!sinks[slot]) {
+            continue;
+        }
+        if (sinks[slot]->commit()) {
+            recordWritten(written[slot]->filepath, input_hashes[slot]);
+        } else {
+            committed = false;
+        }
+    }
+    return committed ? Status::Done : Status::Failed;
+}
+
+// ----- Incremental Export -----
+void ExportJob::prepareManifest() {
+    if (!incremental_) {
+        return;
+    }
+
+    // The options line identifies the kind of export; a manifest written by
+    // a different kind is ignored rather than trusted
+    manifest_ = ExportManifest();
+    static const char* const kFormatNames[] = {"asciidoc", "markdown", "html"};
+    for (const ExportTarget& target : targets_) {
+        if (!manifest_.options.empty()) manifest_.options += ",";
+        manifest_.options += kFormatNames[static_cast<int>(target.format)];
+        if (target.split_chapters) manifest_.options += "+chapters";
+    }
+
+    const auto& sections = model_.sections();
+    manifest_.section_hashes.resize(sections.size());
+    parallelFor(sections.size(), sections.size() >= 1024 ? jobs_ : 1, [&](size_t i) {
+        manifest_.section_hashes[i] = hashSection(sections[i]);
+    });
+    manifest_.set_hash = hashField(title_, kHashSeed);
+    for (uint64_t hash : manifest_.section_hashes) {
+        manifest_.set_hash = hashValue(hash, manifest_.set_hash);
+    }
+
+    if (!previous_.load(ExportManifest::pathFor(targets_.front().filepath)) ||
+        previous_.options != manifest_.options) {
+        previous_ = ExportManifest();
+    }
+}
+
+ExportJob::Status ExportJob::finishManifest(Status status) {
+    if (!incremental_ || status != Status::Done) {
+        return status; // Files written so far no longer match the old manifest and are redone next time
+    }
+
+    // Outputs of the last export that this one no longer produces (chapters
+    // that went away) are removed, unless they were changed since
+    for (const auto& file : previous_.files) {
+        if (!manifest_.files.count(file.first) && previous_.isCurrent(file.first, file.second.input_hash)) {
+            std::remove(file.first.c_str());
+        }
+    }
+    manifest_.save(ExportManifest::pathFor(targets_.front().filepath));
+    return status;
+}
+
+// Hash of everything a file covering sections [first, last) depends on
+uint64_t ExportJob::rangeHash(ExportFormat format, size_t first, size_t last, bool with_title) const {
+    if (!incremental_) {
+        return 0;
+    }
+    uint64_t hash = hashValue(static_cast<uint64_t>(format), kHashSeed);
+    if (with_title) {
+        hash = hashField(title_, hash);
+    }
+    for (size_t i = first; i < last; ++i) {
+        hash = hashValue(manifest_.section_hashes[i], hash);
+    }
+    return hash;
+}
+
+bool ExportJob::skipIfCurrent(const std::string& path, uint64_t input_hash) {
+    if (!incremental_ || !previous_.isCurrent(path, input_hash)) {
+        return false;
+    }
+    manifest_.files[path] = previous_.files.at(path);
+    ++files_skipped_;
+    return true;
+}
+
+void ExportJob::recordWritten(const std::string& path, uint64_t input_hash) {
+    if (incremental_) {
+        manifest_.record(path, input_hash);
+    }
+    ++files_written_;
+}
@@ -0,0 +1,122 @@
+// =====================
+// ExportManifest.cpp
+// =====================
+// Implements the export manifest sidecar
+// =====================
+
+#include "export_manifest.h"
+#include "file_sink.h"
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace {
+
+bool statFile(const std::string& path, uint64_t& size, int64_t& mtime_ns) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+std::string hex(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016" PRIx64, value);
+    return text;
+}
+
+} // namespace
+
+std::string ExportManifest::pathFor(const std::string& output_path) {
+    size_t slash = output_path.find_last_of('/');
+    size_t name = slash == std::string::npos ? 0 : slash + 1;
+    return output_path.substr(0, name) + "." + output_path.substr(name) + ".docgen-manifest";
+}
+
+// ----- Load & Save -----
+// Text format, one record per line:
+//   docgen-manifest <version>
+//   options <text>
+//   set <hash>
+//   section <hash>
+//   file <hash> <size> <mtime_ns> <path>
+bool ExportManifest::load(const std::string& path) {
+    *this = ExportManifest();
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != "docgen-manifest " + std::to_string(kVersion)) {
+        return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "options") {
+            options = line.size() > 8 ? line.substr(8) : std::string();
+        } else if (kind == "set") {
+            fields >> std::hex >> set_hash;
+        } else if (kind == "section") {
+            uint64_t hash = 0;
+            fields >> std::hex >> hash;
+            section_hashes.push_back(hash);
+        } else if (kind == "file") {
+            Entry entry;
+            fields >> std::hex >> entry.input_hash >> std::dec >> entry.size >> entry.mtime_ns;
+            fields.get(); // The space before the path
+            std::string file;
+            std::getline(fields, file);
+            if (!file.empty()) {
+                files[file] = entry; // A damaged entry just fails to match later
+            }
+        }
+    }
+    return true;
+}
+
+bool ExportManifest::save(const std::string& path) const {
+    std::string text = "docgen-manifest " + std::to_string(kVersion) + "\n";
+    text += "options " + options + "\n";
+    text += "set " + hex(set_hash) + "\n";
+    for (uint64_t hash : section_hashes) {
+        text += "section " + hex(hash) + "\n";
+    }
+    for (const auto& file : files) {
+        text += "file " + hex(file.second.input_hash) + " " + std::to_string(file.second.size) + " " +
+                std::to_string(file.second.mtime_ns) + " " + file.first + "\n";
+    }
+
+    FileSink sink;
+    if (!sink.open(path, text.size())) {
+        return false;
+    }
+    sink.append(text);
+    return sink.commit();
+}
+
+// ----- Contents -----
+bool ExportManifest::isCurrent(const std::string& path, uint64_t input_hash) const {
+    auto it = files.find(path);
+    if (it == files.end() || it->second.input_hash != input_hash) {
+        return false;
+    }
+    uint64_t size;
+    int64_t mtime_ns;
+    return statFile(path, size, mtime_ns) && size == it->second.size && mtime_ns == it->second.mtime_ns;
+}
+
+bool ExportManifest::record(const std::string& path, uint64_t input_hash) {
+    Entry entry;
+    entry.input_hash = input_hash;
+    if (!statFile(path, entry.size, entry.mtime_ns)) {
+        files.erase(path);
+        return false;
+    }
+    files[path] = entry;
+    return true;
+}
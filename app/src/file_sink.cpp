@@ -0,0 +1,219 @@
+// =====================
+// FileSink.cpp
+// =====================
+// Implements the buffered writev file sink
+// =====================
+
+#include "file_sink.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <random>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// ----- Temporary Files -----
+int createTempSibling(const std::string& filepath, std::string& temp_path) {
+    // Created with mode 0666 so the kernel applies the umask, which cannot be
+    // read without changing it for every thread of the process
+    static constexpr char kChars[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    thread_local std::mt19937_64 random(std::random_device{}() ^
+                                        std::hash<std::thread::id>()(std::this_thread::get_id()));
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+        temp_path = filepath + ".";
+        for (int i = 0; i < 6; ++i) {
+            temp_path += kChars[random() % (sizeof(kChars) - 1)];
+        }
+        fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        if (fd < 0 && errno != EEXIST) {
+            return -1;
+        }
+    }
+    if (fd < 0) {
+        return -1;
+    }
+
+    // Keep the permissions of the file being replaced
+    struct stat st;
+    if (stat(filepath.c_str(), &st) == 0) {
+        fchmod(fd, st.st_mode & 07777);
+    }
+    return fd;
+}
+
+// ----- Construction & Destruction -----
+FileSink::FileSink(size_t buffer_size)
+    : buffer_(new char[buffer_size]), buffer_size_(buffer_size) {
+    pending_.reserve(IOV_MAX);
+}
+
+FileSink::~FileSink() {
+    abort();
+}
+
+// ----- Output -----
+bool FileSink::open(const std::string& filepath, uint64_t expected_size) {
+    abort();
+    failed_ = false;
+    written_ = 0;
+    path_ = filepath;
+    fd_ = createTempSibling(filepath, temp_path_);
+    if (fd_ < 0) {
+        return false;
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    // Reserve the blocks up front; a filesystem without support simply skips it
+    if (expected_size > 0) {
+        fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expected_size));
+    }
+#else
+    (void)expected_size;
+#endif
+    return true;
+}
+
+void FileSink::append(std::string_view text) {
+    if (!ok() || text.empty()) {
+        return;
+    }
+
+    if (text.size() >= kDirectThreshold || text.size() > buffer_size_) {
+        if (pending_.size() >= IOV_MAX && !flush()) return;
+        pending_.push_back({const_cast<char*>(text.data()), text.size()});
+        if (text.size() < kDirectThreshold) {
+            flush(); // Only pieces of kDirectThreshold bytes or more may outlive this call
+        }
+        return;
+    }
+
+    if ((buffer_used_ + text.size() > buffer_size_ || pending_.size() >= IOV_MAX) && !flush()) {
+        return;
+    }
+    char* dest = buffer_.get() + buffer_used_;
+    std::memcpy(dest, text.data(), text.size());
+    buffer_used_ += text.size();
+
+    // Consecutive buffered pieces share one iovec
+    if (!pending_.empty() && static_cast<char*>(pending_.back().iov_base) + pending_.back().iov_len == dest) {
+        pending_.back().iov_len += text.size();
+    } else {
+        pending_.push_back({dest, text.size()});
+    }
+}
+
+bool FileSink::flush() {
+    if (!ok()) {
+        return false;
+    }
+
+    struct iovec* iov = pending_.data();
+    size_t count = pending_.size();
+    while (count > 0) {
+        ssize_t n = writev(fd_, iov, static_cast<int>(count));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            return false;
+        }
+        written_ += static_cast<uint64_t>(n);
+
+        // Skip what was written, including a partially written iovec
+        size_t done = static_cast<size_t>(n);
+        while (count > 0 && done >= iov->iov_len) {
+            done -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+
+    pending_.clear();
+    buffer_used_ = 0;
+    return true;
+}
+
+bool FileSink::writeAt(uint64_t offset, std::string_view data) {
+    while (!data.empty()) {
+        if (!ok()) {
+            return false;
+        }
+        ssize_t n = pwrite(fd_, data.data(), data.size(), static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            return false;
+        }
+        written_ += static_cast<uint64_t>(n);
+        offset += static_cast<uint64_t>(n);
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+bool FileSink::commit() {
+    if (!flush()) {
+        abort();
+        return false;
+    }
+    bool closed = ::close(fd_) == 0;
+    fd_ = -1;
+    if (!closed || std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        std::remove(temp_path_.c_str());
+        temp_path_.clear();
+        return false;
+    }
+    temp_path_.clear();
+    return true;
+}
+
+void FileSink::abort() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (!temp_path_.empty()) {
+        std::remove(temp_path_.c_str());
+        temp_path_.clear();
+    }
+    pending_.clear();
+    buffer_used_ = 0;
+}
+
+// ----- Range Writer -----
+FileRangeWriter::FileRangeWriter(FileSink& file, uint64_t offset, size_t buffer_size)
+    : file_(file), offset_(offset), buffer_(new char[buffer_size]), buffer_size_(buffer_size) {
+}
+
+void FileRangeWriter::append(std::string_view text) {
+    if (text.size() >= FileSink::kDirectThreshold || text.size() > buffer_size_) {
+        flush();
+        file_.writeAt(offset_, text);
+        offset_ += text.size();
+        return;
+    }
+    if (buffer_used_ + text.size() > buffer_size_) {
+        flush();
+    }
+    std::memcpy(buffer_.get() + buffer_used_, text.data(), text.size());
+    buffer_used_ += text.size();
+}
+
+bool FileRangeWriter::flush() {
+    bool written = file_.writeAt(offset_, std::string_view(buffer_.get(), buffer_used_));
+    offset_ += buffer_used_;
+    buffer_used_ = 0;
+    return written;
+}
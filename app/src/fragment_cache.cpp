@@ -0,0 +1,158 @@
+// =====================
+// FragmentCache.cpp
+// =====================
+// Implements the per-section rendered fragment cache
+// =====================
+
+#include "fragment_cache.h"
+#include "content_hash.h"
+#include "document_writer.h"
+#include <vector>
+
+// ----- Document Generation -----
+std::string FragmentCache::generate(const DocumentModel& model, FragmentFormat format, const std::string& title) {
+    if (format == FragmentFormat::Html) {
+        return generateHtmlPage(model, title);
+    }
+    ++generation_;
+
+    std::vector<const std::string*> parts;
+    parts.reserve(model.size());
+    size_t total = 0;
+    for (const auto& section : model.sections()) {
+        const std::string& part = fragment(section, entryFor(section), format);
+        parts.push_back(&part);
+        total += part.size();
+    }
+
+    std::string result;
+    if (format == FragmentFormat::AsciiDoc) {
+        DocumentWriter<AsciiDocFormat>::appendTitle(title, result);
+    } else {
+        DocumentWriter<MarkdownFormat>::appendTitle(title, result);
+    }
+    result.reserve(result.size() + total);
+    for (const std::string* part : parts) {
+        result += *part;
+    }
+
+    sweep(model);
+    return result;
+}
+
+std::string FragmentCache::generateHtmlPage(const DocumentModel& model, const std::string& title) {
+    ++generation_;
+    std::string html = htmlPageHead();
+    appendHtmlBody(model, title, html);
+    html += htmlPageTail();
+    sweep(model);
+    return html;
+}
+
+std::string FragmentCache::generateHtmlDocument(const DocumentModel& model, const std::string& title) {
+    ++generation_;
+    std::string html = htmlDocumentHead();
+    appendHtmlBody(model, title, html);
+    html += htmlPageTail();
+    sweep(model);
+    return html;
+}
+
+std::vector<HtmlBlock> FragmentCache::generateHtmlBlocks(const DocumentModel& model, const std::string& title,
+                                                         const std::function<bool()>& cancelled) {
+    ++generation_;
+    std::vector<HtmlBlock> blocks;
+    blocks.reserve(model.size() + 1);
+    blocks.push_back({0, std::string(), 0});
+    HtmlWriter::appendTitle(title, blocks.back().html);
+    for (const auto& section : model.sections()) {
+        if (cancelled && cancelled()) {
+            return {}; // Entries rendered so far stay valid; only the sweep is skipped
+        }
+        blocks.push_back({section.id, fragment(section, entryFor(section), FragmentFormat::Html), 0});
+    }
+    for (HtmlBlock& block : blocks) {
+        block.hash = hashBytes(block.html);
+    }
+    sweep(model);
+    return blocks;
+}
+
+void FragmentCache::appendHtmlBody(const DocumentModel& model, const std::string& title, std::string& html) {
+    HtmlWriter::appendTitle(title, html);
+    for (const auto& section : model.sections()) {
+        html += fragment(section, entryFor(section), FragmentFormat::Html);
+    }
+}
+
+// ----- Cache Management -----
+void FragmentCache::clear() {
+    entries_.clear();
+}
+
+FragmentCache::Entry& FragmentCache::entryFor(const SectionData& section) {
+    auto inserted = entries_.try_emplace(section.id);
+    Entry& entry = inserted.first->second;
+    if (inserted.second) {
+        entry.revision = section.revision;
+        entry.key = makeKey(section);
+    } else if (entry.revision != section.revision) {
+        // Edited since last use; an edit that restores the old key keeps the fragments
+        entry.revision = section.revision;
+        Key key = makeKey(section);
+        if (!(key == entry.key)) {
+            entry.key = std::move(key);
+            for (bool& rendered : entry.rendered) rendered = false;
+        }
+    }
+    entry.seen = generation_;
+    return entry;
+}
+
+const std::string& FragmentCache::fragment(const SectionData& section, Entry& entry, FragmentFormat format) {
+    size_t slot = static_cast<size_t>(format);
+    if (entry.rendered[slot]) {
+        return entry.fragments[slot];
+    }
+
+    std::string& out = entry.fragments[slot];
+    out.clear();
+    switch (format) {
+        case FragmentFormat::AsciiDoc:
+            DocumentWriter<AsciiDocFormat>::appendSection(section, out);
+            break;
+        case FragmentFormat::Markdown:
+            DocumentWriter<MarkdownFormat>::appendSection(section, out);
+            break;
+        case FragmentFormat::Html:
+            HtmlWriter::appendSection(section, out);
+            break;
+    }
+    entry.rendered[slot] = true;
+    ++renders_;
+    return out;
+}
+
+void FragmentCache::sweep(const DocumentModel& model) {
+    // Drop entries of deleted sections
+    if (entries_.size() <= model.size()) {
+        return;
+    }
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.seen != generation_) {
+            it = entries_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+FragmentCache::Key FragmentCache::makeKey(const SectionData& section) {
+    Key key;
+    key.content_hash = hashBytes(section.body());
+    key.header = section.header;
+    key.headline = section.headline;
+    key.level = section.level;
+    key.type = section.type;
+    return key;
+}
@@ -0,0 +1,160 @@
+// =====================
+// HtmlRenderer.cpp
+// =====================
+// Implements HTML scanning and the preview and export page assembly
+// =====================
+
+#include "html_renderer.h"
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define HTML_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// ----- Scanning -----
+namespace {
+
+// Byte classes: a scan without newlines stops at kEscape and above, one with
+// newlines at kNewline and above. Escapes index kEntities.
+enum ByteClass : uint8_t { kPlain = 0, kNewline = 1, kEscape = 2 };
+
+constexpr std::string_view kEntities[] = {"", "", "&amp;", "&lt;", "&gt;", "&quot;"};
+
+struct ByteClassTable {
+    uint8_t classes[256] = {};
+
+    constexpr ByteClassTable() {
+        classes[static_cast<uint8_t>('\n')] = kNewline;
+        classes[static_cast<uint8_t>('&')] = kEscape;
+        classes[static_cast<uint8_t>('<')] = kEscape + 1;
+        classes[static_cast<uint8_t>('>')] = kEscape + 2;
+        classes[static_cast<uint8_t>('"')] = kEscape + 3;
+    }
+};
+
+constexpr ByteClassTable kByteClasses;
+
+size_t scanScalar(const char* data, size_t from, size_t size, bool newlines) {
+    const uint8_t stop = newlines ? kNewline : kEscape;
+    for (size_t i = from; i < size; ++i) {
+        if (kByteClasses.classes[static_cast<uint8_t>(data[i])] >= stop) {
+            return i;
+        }
+    }
+    return size;
+}
+
+#ifdef HTML_SCAN_X86
+size_t scanSse2(const char* data, size_t from, size_t size, bool newlines) {
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i quot = _mm_set1_epi8('"');
+    // Without newlines, compare against '&' twice instead
+    const __m128i newline = _mm_set1_epi8(newlines ? '\n' : '&');
+    size_t i = from;
+    for (; i + 16 <= size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, amp), _mm_cmpeq_epi8(bytes, lt)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(bytes, gt), _mm_cmpeq_epi8(bytes, quot)));
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(bytes, newline));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return scanScalar(data, i, size, newlines);
+}
+
+__attribute__((target("avx2"))) size_t scanAvx2(const char* data, size_t from, size_t size, bool newlines) {
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i gt = _mm256_set1_epi8('>');
+    const __m256i quot = _mm256_set1_epi8('"');
+    const __m256i newline = _mm256_set1_epi8(newlines ? '\n' : '&');
+    size_t i = from;
+    for (; i + 32 <= size; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i hits =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, amp), _mm256_cmpeq_epi8(bytes, lt)),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, gt), _mm256_cmpeq_epi8(bytes, quot)));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(bytes, newline));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return scanSse2(data, i, size, newlines);
+}
+#endif
+
+using ScanFunction = size_t (*)(const char*, size_t, size_t, bool);
+
+ScanFunction selectScan() {
+#ifdef HTML_SCAN_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? scanAvx2 : scanSse2;
+#else
+    return scanScalar;
+#endif
+}
+
+} // namespace
+
+size_t findHtmlSpecial(std::string_view text, size_t from, bool newlines) {
+    static const ScanFunction scan = selectScan();
+    return scan(text.data(), from, text.size(), newlines);
+}
+
+std::string_view htmlEntity(char c) {
+    return kEntities[kByteClasses.classes[static_cast<uint8_t>(c)]];
+}
+
+// ----- Page Assembly -----
+namespace {
+
+// Shared by the preview and exported pages; only the body rule differs
+std::string pageHead(std::string_view body_rules) {
+    std::string head = R"(
+<!DOCTYPE html>
+<html>
+<head>
+<meta charset="UTF-8">
+<style>
+)";
+    head.append(body_rules.data(), body_rules.size());
+    head += R"(h1 { font-size: 2em; margin-top: 0; }
+h2 { font-size: 1.5em; margin-top: 1em; }
+h3 { font-size: 1.25em; margin-top: 0.8em; }
+h4 { font-size: 1.1em; margin-top: 0.6em; }
+blockquote { border-left: 4px solid #ddd; padding-left: 15px; color: #666; margin: 1em 0; word-wrap: break-word; }
+pre { background: #f5f5f5; border: 1px solid #ddd; padding: 10px; border-radius: 4px; overflow-x: auto; white-space: pre-wrap; word-wrap: break-word; max-width: 100%; }
+code { background: #f0f0f0; padding: 2px 4px; border-radius: 3px; }
+</style>
+</head>
+<body>
+)";
+    return head;
+}
+
+} // namespace
+
+const std::string& htmlPageHead() {
+    // The preview shows the whole page scaled down to a thumbnail
+    static const std::string head = pageHead(
+        "html, body { margin: 0; padding: 0; overflow-x: hidden; }\n"
+        "body { font-family: sans-serif; padding: 10px; line-height: 1.6; transform: scale(0.2); transform-origin: top left; width: 460%; max-width: 460%; word-wrap: break-word; overflow-wrap: break-word; box-sizing: border-box; }\n");
+    return head;
+}
+
+const std::string& htmlDocumentHead() {
+    static const std::string head = pageHead(
+        "body { font-family: sans-serif; max-width: 50em; margin: 0 auto; padding: 1em; line-height: 1.6; word-wrap: break-word; overflow-wrap: break-word; }\n");
+    return head;
+}
+
+const std::string& htmlPageTail() {
+    static const std::string tail = "</body></html>";
+    return tail;
+}
@@ -1,5 +1,12 @@
 #include <gtk/gtk.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "batch_export.h"
 #include "main_window.h"
+#include "render_server.h"
+#include "watch_export.h"
 
 // External reference to compiled GResource
 extern "C" {
@@ -18,6 +25,21 @@ static void activate(GtkApplication* app, gpointer user_data) {
 }
 
 int main(int argc, char** argv) {
+    // The command-line modes (export, watch, serve, render) run headless:
+    // no display, no widgets
+    if (argc > 1 && std::strcmp(argv[1], "export") == 0) {
+        return BatchExport::main(std::vector<std::string>(argv + 2, argv + argc), std::cout, std::cerr);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "watch") == 0) {
+        return WatchExport::main(std::vector<std::string>(argv + 2, argv + argc), std::cout, std::cerr);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "serve") == 0) {
+        return RenderServer::main(std::vector<std::string>(argv + 2, argv + argc), std::cout, std::cerr);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "render") == 0) {
+        return RenderServer::clientMain(std::vector<std::string>(argv + 2, argv + argc), std::cout, std::cerr);
+    }
+
     // Register embedded resources
     GResource* resource = docgen_get_resource();
     g_resources_register(resource);
@@ -1,12 +1,14 @@
 #include "main_window.h"
+#include <cstring>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 
 MainWindow::MainWindow(GtkApplication* app)
     : window_(nullptr), main_vbox_(nullptr), section_manager_(nullptr),
       document_title_entry_(nullptr), preview_web_view_(nullptr),
-      has_unsaved_changes_(false), current_set_file_("") {
+      has_unsaved_changes_(false), current_set_file_(""),
+      export_bar_(nullptr), export_label_(nullptr), export_progress_(nullptr),
+      export_cancel_button_(nullptr), export_run_(nullptr), export_progress_id_(0),
+      preview_loaded_(false), preview_idle_id_(0) {
     
     window_ = gtk_application_window_new(app);
     gtk_window_set_title(GTK_WINDOW(window_), "Doc Generator");
@@ -23,10 +25,24 @@ MainWindow::MainWindow(GtkApplication* app)
 
     createMenuBar();
     createUI();
+    createExportBar();
 }
 
 MainWindow::~MainWindow() {
-    // GTK handles widget cleanup
+    // GTK handles widget cleanup; a running export is cancelled and
+    // finishes without the window
+    if (export_run_) {
+        export_run_->window = nullptr;
+        export_run_->job.cancel();
+    }
+    if (export_progress_id_) {
+        g_source_remove(export_progress_id_);
+    }
+    // Joining the renderer first guarantees no new idle source appears
+    preview_renderer_.reset();
+    if (preview_idle_id_) {
+        g_source_remove(preview_idle_id_);
+    }
 }
 
 void MainWindow::updateTitle() {
@@ -86,6 +102,18 @@ void MainWindow::createMenuBar() {
     g_signal_connect(create_md_item, "activate", G_CALLBACK(onCreateMarkdown), this);
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), create_md_item);
 
+    GtkWidget* export_all_item = gtk_menu_item_new_with_label("Export All Formats...");
+    g_signal_connect(export_all_item, "activate", G_CALLBACK(onExportAll), this);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), export_all_item);
+
+    GtkWidget* export_chapters_item = gtk_menu_item_new_with_label("Export Chapters...");
+    g_signal_connect(export_chapters_item, "activate", G_CALLBACK(onExportChapters), this);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), export_chapters_item);
+
+    GtkWidget* export_book_item = gtk_menu_item_new_with_label("Export Book...");
+    g_signal_connect(export_book_item, "activate", G_CALLBACK(onExportBook), this);
+    gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), export_book_item);
+
     gtk_menu_shell_append(GTK_MENU_SHELL(edit_menu), gtk_separator_menu_item_new());
 
     GtkWidget* clear_item = gtk_menu_item_new_with_label("Clear All");
@@ -333,9 +361,23 @@ void MainWindow::createUI() {
     gtk_widget_set_margin_end(preview_scrolled, 12);
     gtk_widget_set_margin_bottom(preview_scrolled, 8);
     
-    // Preview web view for HTML rendering
-    preview_web_view_ = WEBKIT_WEB_VIEW(webkit_web_view_new());
+    // Preview web view for HTML rendering; the page script applies
+    // incremental updates and asks for blocks as they scroll into view
+    // (see PreviewPatcher)
+    WebKitUserContentManager* content_manager = webkit_user_content_manager_new();
+    g_signal_connect(content_manager, "script-message-received::docgen", G_CALLBACK(onPreviewMessage), this);
+    webkit_user_content_manager_register_script_message_handler(content_manager, "docgen");
+    WebKitUserScript* patch_script = webkit_user_script_new(PreviewPatcher::script().c_str(),
+                                                            WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+                                                            WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+                                                            NULL, NULL);
+    webkit_user_content_manager_add_script(content_manager, patch_script);
+    webkit_user_script_unref(patch_script);
+    preview_web_view_ = WEBKIT_WEB_VIEW(webkit_web_view_new_with_user_content_manager(content_manager));
+    g_object_unref(content_manager); // Owned by the web view now
     webkit_web_view_set_editable(preview_web_view_, FALSE);
+    g_signal_connect(preview_web_view_, "load-changed", G_CALLBACK(onPreviewLoadChanged), this);
+    g_signal_connect(preview_web_view_, "web-process-terminated", G_CALLBACK(onPreviewProcessTerminated), this);
     gtk_container_add(GTK_CONTAINER(preview_scrolled), GTK_WIDGET(preview_web_view_));
     
     gtk_box_pack_start(GTK_BOX(preview_vbox), preview_scrolled, TRUE, TRUE, 0);
@@ -350,9 +392,10 @@ void MainWindow::createUI() {
     gtk_box_pack_start(GTK_BOX(main_vbox_), order_preview_hbox, FALSE, FALSE, 0);
     
     // Connect signal to update preview when document title changes
+    // (routed through the section manager so batched updates cover it)
     g_signal_connect(document_title_entry_, "changed", G_CALLBACK(+[](GtkEntry*, gpointer data) {
         MainWindow* window = static_cast<MainWindow*>(data);
-        window->updatePreview();
+        window->section_manager_->notifyContentChanged();
     }), this);
 
     // Frame for text sections
@@ -406,6 +449,32 @@ void MainWindow::createUI() {
     });
 }
 
+void MainWindow::createExportBar() {
+    // Shown at the bottom of the window only while an export runs
+    export_bar_ = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+    gtk_widget_set_margin_start(export_bar_, 12);
+    gtk_widget_set_margin_end(export_bar_, 12);
+    gtk_widget_set_margin_bottom(export_bar_, 8);
+
+    export_label_ = gtk_label_new("");
+    gtk_box_pack_start(GTK_BOX(export_bar_), export_label_, FALSE, FALSE, 0);
+
+    export_progress_ = gtk_progress_bar_new();
+    gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(export_progress_), TRUE);
+    gtk_widget_set_valign(export_progress_, GTK_ALIGN_CENTER);
+    gtk_box_pack_start(GTK_BOX(export_bar_), export_progress_, TRUE, TRUE, 0);
+
+    export_cancel_button_ = gtk_button_new_with_label("Cancel");
+    g_signal_connect(export_cancel_button_, "clicked", G_CALLBACK(onCancelExport), this);
+    gtk_box_pack_start(GTK_BOX(export_bar_), export_cancel_button_, FALSE, FALSE, 0);
+
+    gtk_widget_show(export_label_);
+    gtk_widget_show(export_progress_);
+    gtk_widget_show(export_cancel_button_);
+    gtk_widget_set_no_show_all(export_bar_, TRUE);
+    gtk_box_pack_end(GTK_BOX(main_vbox_), export_bar_, FALSE, FALSE, 0);
+}
+
 void MainWindow::show() {
     gtk_widget_show_all(window_);
 }
@@ -416,6 +485,185 @@ std::string MainWindow::getDocumentTitle() const {
     return title.empty() ? "Default title" : title;
 }
 
+bool MainWindow::saveSetFile(const std::string& filepath) {
+    // The placeholder title is not stored in the set file
+    std::string doc_title = getDocumentTitle();
+    return section_manager_->saveToFile(filepath, doc_title != "Default title" ? doc_title : "");
+}
+
+bool MainWindow::ensureSetSaved() {
+    if (!current_set_file_.empty() && !has_unsaved_changes_) {
+        return true;
+    }
+
+    // Prompt to save the set first
+    GtkWidget* dialog = gtk_file_chooser_dialog_new("Save Section Set",
+                                                     getWindow(),
+                                                     GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                     "_Cancel", GTK_RESPONSE_CANCEL,
+                                                     "_Save", GTK_RESPONSE_ACCEPT,
+                                                     NULL);
+    
+    if (!current_set_file_.empty()) {
+        gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(dialog), current_set_file_.c_str());
+    }
+    
+    gint response = gtk_dialog_run(GTK_DIALOG(dialog));
+    gchar* filename = NULL;
+    
+    if (response == GTK_RESPONSE_ACCEPT) {
+        filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+    }
+    
+    // Destroy dialog immediately after getting response
+    gtk_widget_destroy(dialog);
+    
+    if (response != GTK_RESPONSE_ACCEPT || !filename) {
+        return false; // User cancelled
+    }
+    
+    if (!saveSetFile(filename)) {
+        g_free(filename);
+        
+        GtkWidget* error_dialog = gtk_message_dialog_new(getWindow(),
+                                                         GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                         GTK_MESSAGE_ERROR,
+                                                         GTK_BUTTONS_OK,
+                                                         "Failed to save section set.");
+        gtk_dialog_run(GTK_DIALOG(error_dialog));
+        gtk_widget_destroy(error_dialog);
+        return false;
+    }
+    
+    current_set_file_ = filename;
+    has_unsaved_changes_ = false;
+    updateTitle();
+    g_free(filename);
+    return true;
+}
+
+bool MainWindow::ensureNoExportRunning() {
+    if (!export_run_) {
+        return true;
+    }
+    GtkWidget* dialog = gtk_message_dialog_new(getWindow(),
+                                               GTK_DIALOG_DESTROY_WITH_PARENT,
+                                               GTK_MESSAGE_INFO,
+                                               GTK_BUTTONS_OK,
+                                               "An export is already running.");
+    gtk_dialog_run(GTK_DIALOG(dialog));
+    gtk_widget_destroy(dialog);
+    return false;
+}
+
+void MainWindow::startExport(std::vector<ExportTarget> targets, const std::string& book_path) {
+    // Copying the model is the only work done on the main thread
+    std::string filepath = targets.front().filepath;
+    if (book_path.empty()) {
+        export_run_ = new ExportRun{this, ExportJob(section_manager_->getModel(), getDocumentTitle(), std::move(targets))};
+    } else {
+        export_run_ = new ExportRun{this, ExportJob(DocumentModel(), "", std::move(targets))};
+        export_run_->job.setBookSource(book_path); // Sets are loaded on the worker
+    }
+    export_run_->job.setIncremental(true); // Unchanged output files keep their mtime
+
+    char* basename = g_path_get_basename(filepath.c_str());
+    std::string label = std::string("Exporting ") + basename + "...";
+    g_free(basename);
+    gtk_label_set_text(GTK_LABEL(export_label_), label.c_str());
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(export_progress_), 0.0);
+    gtk_widget_set_sensitive(export_cancel_button_, TRUE);
+    gtk_widget_show(export_bar_);
+    export_progress_id_ = g_timeout_add(100, onExportProgress, this);
+
+    GTask* task = g_task_new(NULL, NULL, onExportFinished, export_run_);
+    g_task_set_task_data(task, export_run_, [](gpointer data) {
+        delete static_cast<ExportRun*>(data);
+    });
+    g_task_run_in_thread(task, exportThread);
+    g_object_unref(task);
+}
+
+namespace {
+
+const char* exportFailureMessage(const ExportJob& job) {
+    if (job.targets().size() != 1) {
+        return "Failed to export documents.";
+    }
+    if (job.targets().front().split_chapters) {
+        return "Failed to export chapter files.";
+    }
+    switch (job.targets().front().format) {
+        case ExportFormat::AsciiDoc: return "Failed to create AsciiDoc file.";
+        case ExportFormat::Markdown: return "Failed to create Markdown file.";
+        case ExportFormat::Html: return "Failed to create HTML file.";
+    }
+    return "Failed to export document.";
+}
+
+} // namespace
+
+void MainWindow::finishExport(const ExportJob& job, ExportJob::Status status) {
+    export_run_ = nullptr;
+    if (export_progress_id_) {
+        g_source_remove(export_progress_id_);
+        export_progress_id_ = 0;
+    }
+    gtk_widget_hide(export_bar_);
+
+    if (status == ExportJob::Status::Failed) {
+        GtkWidget* error_dialog = gtk_message_dialog_new(getWindow(),
+                                                         GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                         GTK_MESSAGE_ERROR,
+                                                         GTK_BUTTONS_OK,
+                                                         "%s",
+                                                         exportFailureMessage(job));
+        if (!job.error().empty()) {
+            gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(error_dialog), "%s", job.error().c_str());
+        }
+        gtk_dialog_run(GTK_DIALOG(error_dialog));
+        gtk_widget_destroy(error_dialog);
+    }
+}
+
+// Runs on a worker thread; touches only the job
+void MainWindow::exportThread(GTask* task, gpointer source_object, gpointer task_data,
+                              GCancellable* cancellable) {
+    (void)source_object;
+    (void)cancellable;
+    ExportRun* run = static_cast<ExportRun*>(task_data);
+    g_task_return_int(task, static_cast<gssize>(run->job.run()));
+}
+
+void MainWindow::onExportFinished(GObject* source_object, GAsyncResult* result, gpointer user_data) {
+    (void)source_object;
+    ExportRun* run = static_cast<ExportRun*>(user_data);
+    auto status = static_cast<ExportJob::Status>(g_task_propagate_int(G_TASK(result), NULL));
+    if (run->window) {
+        run->window->finishExport(run->job, status);
+    }
+}
+
+gboolean MainWindow::onExportProgress(gpointer user_data) {
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->export_run_) {
+        window->export_progress_id_ = 0;
+        return G_SOURCE_REMOVE;
+    }
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(window->export_progress_),
+                                  window->export_run_->job.progress());
+    return G_SOURCE_CONTINUE;
+}
+
+void MainWindow::onCancelExport(GtkButton* button, gpointer user_data) {
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (window->export_run_) {
+        window->export_run_->job.cancel();
+        gtk_label_set_text(GTK_LABEL(window->export_label_), "Cancelling...");
+        gtk_widget_set_sensitive(GTK_WIDGET(button), FALSE);
+    }
+}
+
 // Static callback implementations
 void MainWindow::onAddSection(GtkMenuItem* item, gpointer user_data) {
     (void)item;
@@ -437,7 +685,6 @@ void MainWindow::onAddSection(GtkMenuItem* item, gpointer user_data) {
             std::string header = basename;
             window->section_manager_->addSection(header, content);
             window->has_unsaved_changes_ = true;
-            window->updatePreview();
         } catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << std::endl;
             GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
@@ -460,53 +707,13 @@ void MainWindow::onAddSection(GtkMenuItem* item, gpointer user_data) {
 void MainWindow::onCreateDoc(GtkMenuItem* item, gpointer user_data) {
     (void)item;
     MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->ensureNoExportRunning()) {
+        return;
+    }
     
     // First, ensure the set is saved
-    if (window->current_set_file_.empty() || window->has_unsaved_changes_) {
-        // Prompt to save the set first
-        GtkWidget* dialog = gtk_file_chooser_dialog_new("Save Section Set",
-                                                         window->getWindow(),
-                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
-                                                         "_Cancel", GTK_RESPONSE_CANCEL,
-                                                         "_Save", GTK_RESPONSE_ACCEPT,
-                                                         NULL);
-        
-        if (!window->current_set_file_.empty()) {
-            gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(dialog), window->current_set_file_.c_str());
-        }
-        
-        gint response = gtk_dialog_run(GTK_DIALOG(dialog));
-        gchar* filename = NULL;
-        
-        if (response == GTK_RESPONSE_ACCEPT) {
-            filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
-        }
-        
-        // Destroy dialog immediately after getting response
-        gtk_widget_destroy(dialog);
-        
-        if (response == GTK_RESPONSE_ACCEPT && filename) {
-            if (window->section_manager_->saveToFile(filename)) {
-                window->current_set_file_ = filename;
-                window->has_unsaved_changes_ = false;
-                window->updateTitle();
-            } else {
-                g_free(filename);
-                
-                GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
-                                                                 GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                                 GTK_MESSAGE_ERROR,
-                                                                 GTK_BUTTONS_OK,
-                                                                 "Failed to save section set.");
-                gtk_dialog_run(GTK_DIALOG(error_dialog));
-                gtk_widget_destroy(error_dialog);
-                return;
-            }
-            
-            g_free(filename);
-        } else {
-            return; // User cancelled
-        }
+    if (!window->ensureSetSaved()) {
+        return;
     }
     
     // Now create the AsciiDoc file
@@ -569,26 +776,8 @@ void MainWindow::onCreateDoc(GtkMenuItem* item, gpointer user_data) {
     gtk_widget_destroy(doc_dialog);
     
     if (doc_response == GTK_RESPONSE_ACCEPT && doc_filename) {
-        // Get document title from input box
-        std::string doc_title = window->getDocumentTitle();
-        
-        // Generate AsciiDoc content
-        std::string asciidoc_content = window->section_manager_->generateAsciiDoc(doc_title);
-        
-        // Write to file
-        std::ofstream doc_file(doc_filename);
-        if (doc_file.is_open()) {
-            doc_file << asciidoc_content;
-            doc_file.close();
-        } else {
-            GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
-                                                             GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                             GTK_MESSAGE_ERROR,
-                                                             GTK_BUTTONS_OK,
-                                                             "Failed to create AsciiDoc file.");
-            gtk_dialog_run(GTK_DIALOG(error_dialog));
-            gtk_widget_destroy(error_dialog);
-        }
+        // Render and write on a worker thread; finishExport() reports the result
+        window->startExport({{ExportFormat::AsciiDoc, doc_filename}});
         
         g_free(doc_filename);
     }
@@ -597,53 +786,13 @@ void MainWindow::onCreateDoc(GtkMenuItem* item, gpointer user_data) {
 void MainWindow::onCreateMarkdown(GtkMenuItem* item, gpointer user_data) {
     (void)item;
     MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->ensureNoExportRunning()) {
+        return;
+    }
     
     // First, ensure the set is saved
-    if (window->current_set_file_.empty() || window->has_unsaved_changes_) {
-        // Prompt to save the set first
-        GtkWidget* dialog = gtk_file_chooser_dialog_new("Save Section Set",
-                                                         window->getWindow(),
-                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
-                                                         "_Cancel", GTK_RESPONSE_CANCEL,
-                                                         "_Save", GTK_RESPONSE_ACCEPT,
-                                                         NULL);
-        
-        if (!window->current_set_file_.empty()) {
-            gtk_file_chooser_set_filename(GTK_FILE_CHOOSER(dialog), window->current_set_file_.c_str());
-        }
-        
-        gint response = gtk_dialog_run(GTK_DIALOG(dialog));
-        gchar* filename = NULL;
-        
-        if (response == GTK_RESPONSE_ACCEPT) {
-            filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
-        }
-        
-        // Destroy dialog immediately after getting response
-        gtk_widget_destroy(dialog);
-        
-        if (response == GTK_RESPONSE_ACCEPT && filename) {
-            if (window->section_manager_->saveToFile(filename)) {
-                window->current_set_file_ = filename;
-                window->has_unsaved_changes_ = false;
-                window->updateTitle();
-            } else {
-                g_free(filename);
-                
-                GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
-                                                                 GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                                 GTK_MESSAGE_ERROR,
-                                                                 GTK_BUTTONS_OK,
-                                                                 "Failed to save section set.");
-                gtk_dialog_run(GTK_DIALOG(error_dialog));
-                gtk_widget_destroy(error_dialog);
-                return;
-            }
-            
-            g_free(filename);
-        } else {
-            return; // User cancelled
-        }
+    if (!window->ensureSetSaved()) {
+        return;
     }
     
     // Now create the Markdown file
@@ -706,40 +855,250 @@ void MainWindow::onCreateMarkdown(GtkMenuItem* item, gpointer user_data) {
     gtk_widget_destroy(doc_dialog);
     
     if (doc_response == GTK_RESPONSE_ACCEPT && doc_filename) {
-        // Get document title from input box
-        std::string doc_title = window->getDocumentTitle();
+        // Render and write on a worker thread; finishExport() reports the result
+        window->startExport({{ExportFormat::Markdown, doc_filename}});
         
-        // Generate Markdown content
-        std::string markdown_content = window->section_manager_->generateMarkdown(doc_title);
-        
-        // Write to file
-        std::ofstream doc_file(doc_filename);
-        if (doc_file.is_open()) {
-            doc_file << markdown_content;
-            doc_file.close();
-        } else {
-            GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
-                                                             GTK_DIALOG_DESTROY_WITH_PARENT,
-                                                             GTK_MESSAGE_ERROR,
-                                                             GTK_BUTTONS_OK,
-                                                             "Failed to create Markdown file.");
-            gtk_dialog_run(GTK_DIALOG(error_dialog));
-            gtk_widget_destroy(error_dialog);
+        g_free(doc_filename);
+    }
+}
+
+void MainWindow::onExportAll(GtkMenuItem* item, gpointer user_data) {
+    (void)item;
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->ensureNoExportRunning()) {
+        return;
+    }
+    
+    // First, ensure the set is saved
+    if (!window->ensureSetSaved()) {
+        return;
+    }
+    
+    // One name for all three files; the extensions are added per format
+    GtkWidget* doc_dialog = gtk_file_chooser_dialog_new("Export All Formats",
+                                                         window->getWindow(),
+                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                         "_Cancel", GTK_RESPONSE_CANCEL,
+                                                         "_Export", GTK_RESPONSE_ACCEPT,
+                                                         NULL);
+    
+    // Default to the set file name without .docgenset, in the set's folder
+    char* directory = g_path_get_dirname(window->current_set_file_.c_str());
+    char* basename = g_path_get_basename(window->current_set_file_.c_str());
+    std::string name = basename;
+    if (g_str_has_suffix(basename, ".docgenset")) {
+        name.resize(name.size() - 10);
+    }
+    gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER(doc_dialog), directory);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(doc_dialog), name.c_str());
+    g_free(basename);
+    g_free(directory);
+    
+    gint doc_response = gtk_dialog_run(GTK_DIALOG(doc_dialog));
+    gchar* doc_filename = NULL;
+    
+    if (doc_response == GTK_RESPONSE_ACCEPT) {
+        doc_filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(doc_dialog));
+    }
+    
+    // Destroy dialog immediately after getting response
+    gtk_widget_destroy(doc_dialog);
+    
+    if (doc_response != GTK_RESPONSE_ACCEPT || !doc_filename) {
+        return;
+    }
+    
+    // Drop an extension typed by the user
+    std::string base = doc_filename;
+    g_free(doc_filename);
+    for (const char* extension : {".adoc", ".md", ".html"}) {
+        if (g_str_has_suffix(base.c_str(), extension)) {
+            base.resize(base.size() - strlen(extension));
+            break;
         }
-        
+    }
+    
+    std::vector<ExportTarget> targets = {
+        {ExportFormat::AsciiDoc, base + ".adoc"},
+        {ExportFormat::Markdown, base + ".md"},
+        {ExportFormat::Html, base + ".html"},
+    };
+    
+    // The chooser only confirms overwriting the name it was given
+    bool exists = false;
+    for (const auto& target : targets) {
+        exists = exists || g_file_test(target.filepath.c_str(), G_FILE_TEST_EXISTS);
+    }
+    if (exists) {
+        GtkWidget* confirm_dialog = gtk_message_dialog_new(window->getWindow(),
+                                                           GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                           GTK_MESSAGE_QUESTION,
+                                                           GTK_BUTTONS_YES_NO,
+                                                           "Replace the existing .adoc, .md and .html files?");
+        gint confirm = gtk_dialog_run(GTK_DIALOG(confirm_dialog));
+        gtk_widget_destroy(confirm_dialog);
+        if (confirm != GTK_RESPONSE_YES) {
+            return;
+        }
+    }
+    
+    // All three files are written in one pass on a worker thread
+    window->startExport(std::move(targets));
+}
+
+void MainWindow::onExportChapters(GtkMenuItem* item, gpointer user_data) {
+    (void)item;
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->ensureNoExportRunning()) {
+        return;
+    }
+    
+    // First, ensure the set is saved
+    if (!window->ensureSetSaved()) {
+        return;
+    }
+    
+    // The chosen file becomes the index; its extension picks the format
+    GtkWidget* doc_dialog = gtk_file_chooser_dialog_new("Export Chapters (Index File)",
+                                                         window->getWindow(),
+                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                         "_Cancel", GTK_RESPONSE_CANCEL,
+                                                         "_Export", GTK_RESPONSE_ACCEPT,
+                                                         NULL);
+    
+    GtkFileFilter* md_filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(md_filter, "Markdown files (*.md)");
+    gtk_file_filter_add_pattern(md_filter, "*.md");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(doc_dialog), md_filter);
+    
+    GtkFileFilter* adoc_filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(adoc_filter, "AsciiDoc files (*.adoc)");
+    gtk_file_filter_add_pattern(adoc_filter, "*.adoc");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(doc_dialog), adoc_filter);
+    
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(doc_dialog), TRUE);
+    
+    // Default to the set file name with .md, in the set's folder
+    char* directory = g_path_get_dirname(window->current_set_file_.c_str());
+    char* basename = g_path_get_basename(window->current_set_file_.c_str());
+    std::string name = basename;
+    if (g_str_has_suffix(basename, ".docgenset")) {
+        name.resize(name.size() - 10);
+    }
+    name += ".md";
+    gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER(doc_dialog), directory);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(doc_dialog), name.c_str());
+    g_free(basename);
+    g_free(directory);
+    
+    gint doc_response = gtk_dialog_run(GTK_DIALOG(doc_dialog));
+    gchar* doc_filename = NULL;
+    
+    if (doc_response == GTK_RESPONSE_ACCEPT) {
+        doc_filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(doc_dialog));
+    }
+    
+    // Destroy dialog immediately after getting response
+    gtk_widget_destroy(doc_dialog);
+    
+    if (doc_response == GTK_RESPONSE_ACCEPT && doc_filename) {
+        ExportFormat format = g_str_has_suffix(doc_filename, ".adoc") ? ExportFormat::AsciiDoc
+                                                                      : ExportFormat::Markdown;
+        // Chapter files (name-01.md, ...) are written concurrently on worker threads
+        window->startExport({{format, doc_filename, true}});
+        g_free(doc_filename);
+    }
+}
+
+void MainWindow::onExportBook(GtkMenuItem* item, gpointer user_data) {
+    (void)item;
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (!window->ensureNoExportRunning()) {
+        return;
+    }
+
+    // The book lists saved set files, so the open set is not involved
+    GtkWidget* book_dialog = gtk_file_chooser_dialog_new("Open Book",
+                                                          window->getWindow(),
+                                                          GTK_FILE_CHOOSER_ACTION_OPEN,
+                                                          "_Cancel", GTK_RESPONSE_CANCEL,
+                                                          "_Open", GTK_RESPONSE_ACCEPT,
+                                                          NULL);
+
+    GtkFileFilter* book_filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(book_filter, "Book files (*.docgenbook)");
+    gtk_file_filter_add_pattern(book_filter, "*.docgenbook");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(book_dialog), book_filter);
+
+    gchar* book_filename = NULL;
+    if (gtk_dialog_run(GTK_DIALOG(book_dialog)) == GTK_RESPONSE_ACCEPT) {
+        book_filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(book_dialog));
+    }
+    gtk_widget_destroy(book_dialog);
+    if (!book_filename) {
+        return;
+    }
+
+    // The output's extension picks the format
+    GtkWidget* doc_dialog = gtk_file_chooser_dialog_new("Export Book",
+                                                         window->getWindow(),
+                                                         GTK_FILE_CHOOSER_ACTION_SAVE,
+                                                         "_Cancel", GTK_RESPONSE_CANCEL,
+                                                         "_Export", GTK_RESPONSE_ACCEPT,
+                                                         NULL);
+
+    GtkFileFilter* md_filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(md_filter, "Markdown files (*.md)");
+    gtk_file_filter_add_pattern(md_filter, "*.md");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(doc_dialog), md_filter);
+
+    GtkFileFilter* adoc_filter = gtk_file_filter_new();
+    gtk_file_filter_set_name(adoc_filter, "AsciiDoc files (*.adoc)");
+    gtk_file_filter_add_pattern(adoc_filter, "*.adoc");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(doc_dialog), adoc_filter);
+
+    gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(doc_dialog), TRUE);
+
+    // Default to the book name with .md, next to the book
+    char* directory = g_path_get_dirname(book_filename);
+    char* basename = g_path_get_basename(book_filename);
+    std::string name = basename;
+    if (g_str_has_suffix(basename, ".docgenbook")) {
+        name.resize(name.size() - 11);
+    }
+    name += ".md";
+    gtk_file_chooser_set_current_folder(GTK_FILE_CHOOSER(doc_dialog), directory);
+    gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(doc_dialog), name.c_str());
+    g_free(basename);
+    g_free(directory);
+
+    gchar* doc_filename = NULL;
+    if (gtk_dialog_run(GTK_DIALOG(doc_dialog)) == GTK_RESPONSE_ACCEPT) {
+        doc_filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(doc_dialog));
+    }
+    gtk_widget_destroy(doc_dialog);
+
+    if (doc_filename) {
+        ExportFormat format = g_str_has_suffix(doc_filename, ".adoc") ? ExportFormat::AsciiDoc
+                                                                      : ExportFormat::Markdown;
+        window->startExport({{format, doc_filename}}, book_filename);
         g_free(doc_filename);
     }
+    g_free(book_filename);
 }
 
 void MainWindow::onClearAll(GtkMenuItem* item, gpointer user_data) {
     (void)item;
     MainWindow* window = static_cast<MainWindow*>(user_data);
-    window->section_manager_->clearAll();
-    // Clear the document title field
-    gtk_entry_set_text(GTK_ENTRY(window->document_title_entry_), "");
+    {
+        // Sections and title are cleared with a single preview update
+        SectionManager::UpdateScope scope(*window->section_manager_);
+        window->section_manager_->clearAll();
+        // Clear the document title field
+        gtk_entry_set_text(GTK_ENTRY(window->document_title_entry_), "");
+    }
     window->has_unsaved_changes_ = false;
     window->current_set_file_ = "";
-    window->updatePreview();
 }
 
 void MainWindow::onQuit(GtkMenuItem* item, gpointer user_data) {
@@ -786,21 +1145,7 @@ void MainWindow::onSaveSet(GtkMenuItem* item, gpointer user_data) {
     if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
         gchar* filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
         
-        // First save sections to get content
-        if (window->section_manager_->saveToFile(filename)) {
-            // Prepend document title to file
-            std::string doc_title = window->getDocumentTitle();
-            if (doc_title != "Default title") {
-                std::ifstream input(filename);
-                std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
-                input.close();
-                
-                std::ofstream output(filename);
-                output << "[DOCUMENT_TITLE:" << doc_title << "]\n";
-                output << content;
-                output.close();
-            }
-            
+        if (window->saveSetFile(filename)) {
             window->current_set_file_ = filename;
             window->has_unsaved_changes_ = false;
             window->updateTitle();
@@ -839,16 +1184,22 @@ void MainWindow::onOpenSet(GtkMenuItem* item, gpointer user_data) {
     if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT) {
         gchar* filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
         
-        if (window->section_manager_->loadFromFile(filename)) {
-            window->current_set_file_ = filename;
-            window->has_unsaved_changes_ = false;
-            window->updateTitle();
+        bool loaded;
+        {
+            // Sections and title are loaded with a single preview update
+            SectionManager::UpdateScope scope(*window->section_manager_);
+            loaded = window->section_manager_->loadFromFile(filename);
             // Load document title from the loaded file
             std::string doc_title = window->section_manager_->getLoadedDocumentTitle();
-            if (!doc_title.empty()) {
+            if (loaded && !doc_title.empty()) {
                 gtk_entry_set_text(GTK_ENTRY(window->document_title_entry_), doc_title.c_str());
             }
-            window->updatePreview();
+        }
+        
+        if (loaded) {
+            window->current_set_file_ = filename;
+            window->has_unsaved_changes_ = false;
+            window->updateTitle();
         } else {
             GtkWidget* error_dialog = gtk_message_dialog_new(window->getWindow(),
                                                              GTK_DIALOG_DESTROY_WITH_PARENT,
@@ -898,127 +1249,105 @@ bool MainWindow::promptSaveIfNeeded() {
     }
 }
 
-std::string MainWindow::convertAsciiDocToHTML(const std::string& markdown) {
-    std::string html = R"(
-<!DOCTYPE html>
-<html>
-<head>
-<meta charset="UTF-8">
-<style>
-html, body { margin: 0; padding: 0; overflow-x: hidden; }
-body { font-family: sans-serif; padding: 10px; line-height: 1.6; transform: scale(0.2); transform-origin: top left; width: 460%; max-width: 460%; word-wrap: break-word; overflow-wrap: break-word; box-sizing: border-box; }
-h1 { font-size: 2em; margin-top: 0; }
-h2 { font-size: 1.5em; margin-top: 1em; }
-h3 { font-size: 1.25em; margin-top: 0.8em; }
-h4 { font-size: 1.1em; margin-top: 0.6em; }
-blockquote { border-left: 4px solid #ddd; padding-left: 15px; color: #666; margin: 1em 0; word-wrap: break-word; }
-pre { background: #f5f5f5; border: 1px solid #ddd; padding: 10px; border-radius: 4px; overflow-x: auto; white-space: pre-wrap; word-wrap: break-word; max-width: 100%; }
-code { background: #f0f0f0; padding: 2px 4px; border-radius: 3px; }
-</style>
-</head>
-<body>
-)";
-    
-    std::istringstream stream(markdown);
-    std::string line;
-    bool in_quote = false;
-    bool in_code = false;
-    bool in_paragraph = false;
-    
-    while (std::getline(stream, line)) {
-        // Code block
-        if (line.substr(0, 3) == "```") {
-            if (!in_code) {
-                if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-                html += "<pre><code>";
-                in_code = true;
-            } else {
-                html += "</code></pre>\n";
-                in_code = false;
-            }
-            continue;
-        }
-        
-        if (in_code) {
-            html += line + "\n";
-            continue;
-        }
-        
-        // Document title (# Title)
-        if (line.substr(0, 2) == "# ") {
-            if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-            html += "<h1>" + line.substr(2) + "</h1>\n";
-        }
-        // Level 1 heading (## Heading)
-        else if (line.substr(0, 3) == "## ") {
-            if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-            html += "<h2>" + line.substr(3) + "</h2>\n";
-        }
-        // Level 2 heading (### Heading)
-        else if (line.substr(0, 4) == "### ") {
-            if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-            html += "<h3>" + line.substr(4) + "</h3>\n";
-        }
-        // Level 3 heading (#### Heading)
-        else if (line.substr(0, 5) == "#### ") {
-            if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-            html += "<h4>" + line.substr(5) + "</h4>\n";
-        }
-        // Blockquote (> text)
-        else if (line.substr(0, 2) == "> ") {
-            if (!in_quote) {
-                if (in_paragraph) { html += "</p>\n"; in_paragraph = false; }
-                html += "<blockquote>";
-                in_quote = true;
-            }
-            html += line.substr(2) + "<br>\n";
-        }
-        // Empty line
-        else if (line.empty()) {
-            if (in_quote) {
-                html += "</blockquote>\n";
-                in_quote = false;
-            }
-            if (in_paragraph) {
-                html += "</p>\n";
-                in_paragraph = false;
-            }
-        }
-        // Normal text
-        else {
-            if (in_quote) {
-                html += "</blockquote>\n";
-                in_quote = false;
-            }
-            if (!in_paragraph) {
-                html += "<p>";
-                in_paragraph = true;
+void MainWindow::updatePreview() {
+    if (!preview_web_view_ || !section_manager_) {
+        return;
+    }
+    if (!preview_renderer_) {
+        preview_renderer_.reset(new PreviewRenderer([this](uint64_t generation, std::vector<HtmlBlock> blocks) {
+            // Worker thread: keep only the newest result and wake the main loop once
+            std::lock_guard<std::mutex> lock(preview_mutex_);
+            preview_result_.generation = generation;
+            preview_result_.blocks = std::move(blocks);
+            if (!preview_idle_id_) {
+                preview_idle_id_ = g_idle_add(onPreviewRendered, this);
             }
-            html += line + " ";
-        }
+        }));
     }
-    
-    if (in_paragraph) html += "</p>\n";
-    if (in_quote) html += "</blockquote>\n";
-    if (in_code) html += "</code></pre>\n";
-    
-    html += "</body></html>";
-    return html;
+
+    // Copies only the sections edited since the last request
+    preview_renderer_->request(section_manager_->getModel(), getDocumentTitle());
 }
 
-void MainWindow::updatePreview() {
-    if (!preview_web_view_ || !section_manager_) {
+gboolean MainWindow::onPreviewRendered(gpointer user_data) {
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    PreviewResult result;
+    {
+        std::lock_guard<std::mutex> lock(window->preview_mutex_);
+        result = std::move(window->preview_result_);
+        window->preview_result_ = PreviewResult();
+        window->preview_idle_id_ = 0;
+    }
+    // A newer request is already rendering; its result will follow
+    if (result.generation == window->preview_renderer_->latest()) {
+        window->applyPreview(std::move(result.blocks));
+    }
+    return G_SOURCE_REMOVE;
+}
+
+void MainWindow::applyPreview(std::vector<HtmlBlock> blocks) {
+    if (!preview_patcher_.hasPage()) {
+        // First update (or the page was lost): load the whole page once
+        std::string html_content = preview_patcher_.page(std::move(blocks));
+        preview_loaded_ = false;
+        preview_pending_.clear();
+        webkit_web_view_load_html(preview_web_view_, html_content.c_str(), nullptr);
         return;
     }
-    
-    // Generate Markdown content
-    std::string markdown_content = section_manager_->generateMarkdown(getDocumentTitle());
-    
-    // Convert to HTML for rendering
-    std::string html_content = convertAsciiDocToHTML(markdown_content);
-    
-    // Load HTML content into WebView
-    webkit_web_view_load_html(preview_web_view_, html_content.c_str(), nullptr);
+    if (!preview_loaded_) {
+        preview_pending_ = std::move(blocks); // Patched once the load finishes
+        return;
+    }
+
+    // Replace only the changed blocks in the live page
+    std::string script = preview_patcher_.patch(std::move(blocks));
+    if (!script.empty()) {
+        runPreviewScript(script);
+    }
+}
+
+void MainWindow::runPreviewScript(const std::string& script) {
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    webkit_web_view_evaluate_javascript(preview_web_view_, script.c_str(), static_cast<gssize>(script.size()),
+                                        NULL, NULL, NULL, NULL, NULL);
+#else
+    webkit_web_view_run_javascript(preview_web_view_, script.c_str(), NULL, NULL, NULL);
+#endif
+}
+
+void MainWindow::onPreviewLoadChanged(WebKitWebView* web_view, WebKitLoadEvent event, gpointer user_data) {
+    (void)web_view;
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    if (event != WEBKIT_LOAD_FINISHED) {
+        return;
+    }
+    window->preview_loaded_ = true;
+    if (!window->preview_pending_.empty()) {
+        window->applyPreview(std::move(window->preview_pending_));
+        window->preview_pending_.clear();
+    }
+}
+
+void MainWindow::onPreviewMessage(WebKitUserContentManager* manager, WebKitJavascriptResult* message,
+                                  gpointer user_data) {
+    (void)manager;
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    gchar* text = jsc_value_to_string(webkit_javascript_result_get_js_value(message));
+    std::string script = window->preview_patcher_.handleMessage(text ? text : "");
+    g_free(text);
+    if (!script.empty()) {
+        window->runPreviewScript(script);
+    }
+}
+
+void MainWindow::onPreviewProcessTerminated(WebKitWebView* web_view, WebKitWebProcessTerminationReason reason,
+                                            gpointer user_data) {
+    (void)web_view;
+    (void)reason;
+    // The page and its state went with the web process; load it again
+    MainWindow* window = static_cast<MainWindow*>(user_data);
+    window->preview_patcher_.reset();
+    window->updatePreview();
 }
 
 GtkWindow* MainWindow::getWindow() const {
@@ -0,0 +1,343 @@
+// =====================
+// PreviewPatcher.cpp
+// =====================
+// Implements incremental preview updates
+// =====================
+
+#include "preview_patcher.h"
+#include <algorithm>
+#include <charconv>
+#include <utility>
+#include "html_renderer.h"
+
+namespace {
+
+// Unscaled preview layout: 16px text at line-height 1.6 on a page about
+// 100 characters wide
+constexpr int kLineHeight = 26;
+constexpr size_t kCharsPerLine = 100;
+
+void appendBlockOpen(uint64_t key, std::string& out) {
+    out += "<div class=\"docgen-block\" id=\"docgen-b";
+    out += std::to_string(key);
+    out += "\">";
+}
+
+void appendPlaceholderOpen(uint64_t key, int height, std::string& out) {
+    out += "<div class=\"docgen-block docgen-placeholder\" id=\"docgen-b";
+    out += std::to_string(key);
+    out += "\" style=\"height:";
+    out += std::to_string(height);
+    out += "px\">";
+}
+
+// Appends "key": to a JavaScript object literal being built in out
+void appendObjectKey(uint64_t key, std::string& out) {
+    out += out.empty() ? "{" : ",";
+    out += '"';
+    out += std::to_string(key);
+    out += "\":";
+}
+
+// As a JavaScript string literal (JSON rules plus the line separators JS rejects)
+void appendJsString(const std::string& text, std::string& out) {
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            case '<': out += "\\u003c"; break; // Keeps "</script>" out of the source
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += kHex[c >> 4];
+                    out += kHex[c & 0xf];
+                } else if (c == 0xe2 && i + 2 < text.size() && static_cast<unsigned char>(text[i + 1]) == 0x80 &&
+                           (static_cast<unsigned char>(text[i + 2]) & 0xfe) == 0xa8) {
+                    out += static_cast<unsigned char>(text[i + 2]) == 0xa8 ? "\\u2028" : "\\u2029";
+                    i += 2;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+// ----- Updates -----
+std::string PreviewPatcher::page(std::vector<HtmlBlock> blocks) {
+    size_t size = 0;
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        size += (i < kInitialBlocks ? blocks[i].html.size() : 0) + 96;
+    }
+    std::string html = htmlPageHead();
+    html.reserve(html.size() + size + 64);
+    html += "<div id=\"docgen-root\">";
+    shown_.clear();
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const HtmlBlock& block = blocks[i];
+        if (i < kInitialBlocks) {
+            appendBlockOpen(block.key, html);
+            html += block.html;
+            shown_.insert(block.key);
+        } else {
+            appendPlaceholderOpen(block.key, estimateHeight(block), html);
+        }
+        html += "</div>"; // No text nodes between blocks
+    }
+    html += "</div>";
+    html += htmlPageTail();
+    remember(std::move(blocks));
+    has_page_ = true;
+    return html;
+}
+
+std::string PreviewPatcher::patch(std::vector<HtmlBlock> blocks) {
+    bool reordered = blocks.size() != blocks_.size();
+    for (size_t i = 0; !reordered && i < blocks.size(); ++i) {
+        reordered = blocks[i].key != blocks_[i].key;
+    }
+
+    // Shown blocks get their new HTML; new and hidden ones stay placeholders
+    std::string changed;
+    std::string placeholders;
+    for (const HtmlBlock& block : blocks) {
+        auto it = index_.find(block.key);
+        bool known = it != index_.end();
+        if (known && blocks_[it->second].hash == block.hash) {
+            continue;
+        }
+        if (known && shown_.count(block.key)) {
+            appendObjectKey(block.key, changed);
+            appendJsString(block.html, changed);
+        } else {
+            appendObjectKey(block.key, placeholders);
+            placeholders += std::to_string(estimateHeight(block));
+        }
+    }
+    if (changed.empty() && placeholders.empty() && !reordered) {
+        return std::string();
+    }
+
+    // Only a changed order sends the key list
+    std::string script = "docgenPatch(";
+    if (reordered) {
+        script += '[';
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (i > 0) script += ',';
+            script += '"';
+            script += std::to_string(blocks[i].key);
+            script += '"';
+        }
+        script += ']';
+    } else {
+        script += "null";
+    }
+    script += ',';
+    script += changed.empty() ? "{}" : changed + "}";
+    script += ',';
+    script += placeholders.empty() ? "{}" : placeholders + "}";
+    script += ");";
+    remember(std::move(blocks));
+
+    // Removed blocks are no longer shown
+    if (reordered) {
+        for (auto it = shown_.begin(); it != shown_.end();) {
+            it = index_.count(*it) ? std::next(it) : shown_.erase(it);
+        }
+    }
+    return script;
+}
+
+std::string PreviewPatcher::handleMessage(std::string_view message) {
+    bool fill = message.compare(0, 5, "fill ") == 0;
+    if (!has_page_ || (!fill && message.compare(0, 5, "drop ") != 0)) {
+        return std::string();
+    }
+
+    std::string filled;
+    const char* pos = message.data() + 5;
+    const char* end = message.data() + message.size();
+    while (pos < end) {
+        uint64_t key = 0;
+        auto result = std::from_chars(pos, end, key);
+        if (result.ec != std::errc()) {
+            break;
+        }
+        pos = result.ptr < end ? result.ptr + 1 : end;
+
+        if (!fill) {
+            shown_.erase(key);
+            continue;
+        }
+        // A block deleted since the page asked has nothing to fill
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            shown_.insert(key);
+            appendObjectKey(key, filled);
+            appendJsString(blocks_[it->second].html, filled);
+        }
+    }
+    return filled.empty() ? std::string() : "docgenFill(" + filled + "});";
+}
+
+int PreviewPatcher::estimateHeight(const HtmlBlock& block) {
+    // The writer puts each line and each block element on its own line
+    size_t lines = static_cast<size_t>(std::count(block.html.begin(), block.html.end(), '\n'));
+    lines += block.html.size() / kCharsPerLine;
+    return static_cast<int>(std::min<size_t>(lines, 1u << 20)) * kLineHeight;
+}
+
+void PreviewPatcher::remember(std::vector<HtmlBlock> blocks) {
+    blocks_ = std::move(blocks);
+    index_.clear();
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        index_[blocks_[i].key] = i;
+    }
+}
+
+// ----- Page Script -----
+const std::string& PreviewPatcher::script() {
+    // Elements in the wanted order are walked with a cursor; one that is not
+    // at the cursor is moved there, so unchanged runs are left alone and
+    // everything not in the order ends up after the cursor to be removed.
+    // An IntersectionObserver with a wide margin asks for placeholders
+    // coming near the viewport and turns blocks far outside it back into
+    // placeholders of their measured height.
+    static const std::string source = R"(
+(function() {
+    var observer = null;
+
+    function keyOf(element) { return element.id.substring(8); }
+    function isPlaceholder(element) { return element.classList.contains('docgen-placeholder'); }
+
+    function post(kind, keys) {
+        var handlers = window.webkit && window.webkit.messageHandlers;
+        if (keys.length && handlers && handlers.docgen) handlers.docgen.postMessage(kind + ' ' + keys.join(' '));
+    }
+
+    function empty(element, height) {
+        element.innerHTML = '';
+        element.classList.add('docgen-placeholder');
+        element.style.height = height + 'px';
+    }
+
+    // Placeholders in view that have not been asked for yet
+    function request(elements) {
+        var keys = [];
+        for (var i = 0; i < elements.length; i++) {
+            var element = elements[i];
+            if (element.docgenVisible && isPlaceholder(element) && !element.docgenPending) {
+                element.docgenPending = true;
+                keys.push(keyOf(element));
+            }
+        }
+        post('fill', keys);
+    }
+
+    function onIntersect(entries) {
+        var shown = [];
+        var dropped = [];
+        for (var i = 0; i < entries.length; i++) {
+            var element = entries[i].target;
+            element.docgenVisible = entries[i].isIntersecting;
+            if (element.docgenVisible) {
+                shown.push(element);
+            } else if (!isPlaceholder(element)) {
+                empty(element, element.offsetHeight);
+                dropped.push(keyOf(element));
+            }
+        }
+        request(shown);
+        post('drop', dropped);
+    }
+
+    function start() {
+        var blocks = document.querySelectorAll('#docgen-root > .docgen-block');
+        if (!window.IntersectionObserver) {
+            for (var i = 0; i < blocks.length; i++) blocks[i].docgenVisible = true;
+            request(blocks);
+            return;
+        }
+        observer = new IntersectionObserver(onIntersect, {rootMargin: '100% 0px'});
+        for (var j = 0; j < blocks.length; j++) observer.observe(blocks[j]);
+    }
+    document.addEventListener('DOMContentLoaded', start);
+
+    window.docgenFill = function(filled) {
+        var dropped = [];
+        for (var key in filled) {
+            var element = document.getElementById('docgen-b' + key);
+            if (!element) continue;
+            element.docgenPending = false;
+            if (!element.docgenVisible) {
+                dropped.push(key); // Scrolled away while the answer was on its way
+                continue;
+            }
+            element.innerHTML = filled[key];
+            element.classList.remove('docgen-placeholder');
+            element.style.height = '';
+        }
+        post('drop', dropped);
+    };
+
+    window.docgenPatch = function(order, changed, placeholders) {
+        var root = document.getElementById('docgen-root');
+        if (!root) return false;
+        var created = {};
+        var touched = [];
+        function block(key) {
+            var element = document.getElementById('docgen-b' + key);
+            if (!element) {
+                element = document.createElement('div');
+                element.className = 'docgen-block';
+                element.id = 'docgen-b' + key;
+                created[key] = element;
+            }
+            return element;
+        }
+        for (var key in changed) {
+            var element = block(key);
+            if (!isPlaceholder(element)) element.innerHTML = changed[key]; // Else dropped meanwhile
+        }
+        for (var key in placeholders) {
+            var element = block(key);
+            empty(element, placeholders[key]);
+            touched.push(element);
+        }
+        if (order) {
+            var cursor = root.firstChild;
+            for (var i = 0; i < order.length; i++) {
+                var element = created[order[i]] || document.getElementById('docgen-b' + order[i]);
+                if (!element) continue;
+                if (element === cursor) {
+                    cursor = cursor.nextSibling;
+                } else {
+                    root.insertBefore(element, cursor);
+                }
+            }
+            while (cursor) {
+                var next = cursor.nextSibling;
+                if (observer) observer.unobserve(cursor);
+                root.removeChild(cursor);
+                cursor = next;
+            }
+        }
+        for (var key in created) {
+            if (observer) observer.observe(created[key]);
+            else created[key].docgenVisible = true;
+        }
+        request(touched); // Emptied while in view; new blocks report through the observer
+        return true;
+    };
+})();
+)";
+    return source;
+}
@@ -0,0 +1,107 @@
+// =====================
+// PreviewRenderer.cpp
+// =====================
+// Implements the background preview renderer
+// =====================
+
+#include "preview_renderer.h"
+#include <utility>
+
+// ----- Construction & Destruction -----
+PreviewRenderer::PreviewRenderer(Deliver deliver)
+    : deliver_(std::move(deliver)), worker_([this] { workerLoop(); }) {
+}
+
+PreviewRenderer::~PreviewRenderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ++generation_; // Makes a render in progress stop at its next section
+    wake_.notify_one();
+    worker_.join();
+}
+
+// ----- Requests -----
+uint64_t PreviewRenderer::request(const DocumentModel& model, std::string title) {
+    // Only sections that are new or edited are copied; the rest are known
+    // to the worker by ID
+    std::vector<uint64_t> order;
+    order.reserve(model.size());
+    std::vector<const SectionData*> changed;
+    std::unordered_map<uint64_t, uint64_t> sent;
+    sent.reserve(model.size());
+    for (const SectionData& section : model.sections()) {
+        order.push_back(section.id);
+        auto previous = sent_.find(section.id);
+        if (previous == sent_.end() || previous->second != section.revision) {
+            changed.push_back(&section);
+        }
+        sent.emplace(section.id, section.revision);
+    }
+    sent_ = std::move(sent);
+    sent_count_ += changed.size();
+
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation = ++generation_;
+        pending_order_ = std::move(order);
+        for (const SectionData* section : changed) {
+            pending_sections_[section->id] = *section;
+        }
+        pending_title_ = std::move(title);
+        pending_ = true;
+    }
+    wake_.notify_one();
+    return generation;
+}
+
+// ----- Worker Thread -----
+void PreviewRenderer::workerLoop() {
+    for (;;) {
+        std::vector<uint64_t> order;
+        std::unordered_map<uint64_t, SectionData> changed;
+        std::string title;
+        uint64_t generation;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return pending_ || stopping_; });
+            if (stopping_) {
+                return;
+            }
+            order = std::move(pending_order_);
+            changed = std::move(pending_sections_);
+            title = std::move(pending_title_);
+            pending_order_.clear();
+            pending_sections_.clear();
+            pending_ = false;
+            generation = generation_;
+        }
+        applyChanges(order, std::move(changed));
+
+        // Fragments rendered before a cancel stay cached for the next request
+        std::vector<HtmlBlock> blocks =
+            cache_.generateHtmlBlocks(model_, title, [&] { return generation_ != generation; });
+        if (blocks.empty() || generation_ != generation) {
+            continue;
+        }
+        ++renders_;
+        deliver_(generation, std::move(blocks));
+    }
+}
+
+void PreviewRenderer::applyChanges(const std::vector<uint64_t>& order,
+                                   std::unordered_map<uint64_t, SectionData> changed) {
+    // Sections are moved, not copied, into the new order; those left out are gone
+    DocumentModel model;
+    for (uint64_t id : order) {
+        auto edited = changed.find(id);
+        if (edited != changed.end()) {
+            model.append(std::move(edited->second));
+        } else if (SectionData* kept = model_.find(id)) {
+            model.append(std::move(*kept));
+        }
+    }
+    model_ = std::move(model);
+}
@@ -0,0 +1,587 @@
+// =====================
+// RenderServer.cpp
+// =====================
+// Implements the Unix socket render daemon and its client
+// =====================
+
+#include "render_server.h"
+#include "content_hash.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+bool parseFormat(std::string_view name, ExportFormat& format) {
+    if (name == "adoc") {
+        format = ExportFormat::AsciiDoc;
+    } else if (name == "md") {
+        format = ExportFormat::Markdown;
+    } else if (name == "html") {
+        format = ExportFormat::Html;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Splits "<format> <kind> <argument>"
+bool splitRequest(std::string_view line, std::string_view& format, std::string_view& kind,
+                  std::string_view& argument) {
+    size_t first = line.find(' ');
+    if (first == std::string_view::npos) {
+        return false;
+    }
+    size_t second = line.find(' ', first + 1);
+    if (second == std::string_view::npos) {
+        return false;
+    }
+    format = line.substr(0, first);
+    kind = line.substr(first + 1, second - first - 1);
+    argument = line.substr(second + 1);
+    return !argument.empty();
+}
+
+bool parseSize(std::string_view text, size_t& value) {
+    if (text.empty() || text.size() > 19) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<size_t>(c - '0');
+    }
+    return true;
+}
+
+bool socketAddress(const std::string& path, sockaddr_un& address, std::string& error) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "socket path too long: " + path;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int connectTo(const std::string& path, std::string& error) {
+    sockaddr_un address;
+    if (!socketAddress(path, address, error)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error = std::string("cannot connect to ") + path + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+// Buffered reads of lines and counted byte runs from a socket
+class SocketReader {
+public:
+    explicit SocketReader(int fd) : fd_(fd) {}
+
+    // False at end of stream, on errors and on over-long lines
+    bool readLine(std::string& line, size_t max_bytes) {
+        while (true) {
+            size_t newline = buffer_.find('\n', start_);
+            if (newline != std::string::npos) {
+                line.assign(buffer_, start_, newline - start_);
+                start_ = newline + 1;
+                return true;
+            }
+            if (buffer_.size() - start_ > max_bytes || !fill()) {
+                return false;
+            }
+        }
+    }
+
+    // count comes from the peer: reserve no more than kMaxReserve up front and
+    // let the string grow as bytes actually arrive
+    bool readBytes(size_t count, std::string& out) {
+        out.clear();
+        out.reserve(std::min(count, kMaxReserve));
+        while (out.size() < count) {
+            if (start_ == buffer_.size() && !fill()) {
+                return false;
+            }
+            size_t take = std::min(count - out.size(), buffer_.size() - start_);
+            out.append(buffer_, start_, take);
+            start_ += take;
+        }
+        return true;
+    }
+
+private:
+    static constexpr size_t kMaxReserve = 1u << 20;
+
+    int fd_;
+    std::string buffer_;
+    size_t start_ = 0;
+
+    bool fill() {
+        buffer_.erase(0, start_);
+        start_ = 0;
+        char chunk[64 * 1024];
+        while (true) {
+            ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            buffer_.append(chunk, static_cast<size_t>(n));
+            return true;
+        }
+    }
+};
+
+} // namespace
+
+// ----- Construction & Destruction -----
+RenderServer::RenderServer(size_t jobs) : jobs_(resolveJobs(jobs)) {
+}
+
+RenderServer::~RenderServer() {
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        unlink(socket_path_.c_str());
+    }
+}
+
+// ----- Service -----
+bool RenderServer::listen(const std::string& socket_path, std::string& error) {
+    sockaddr_un address;
+    if (!socketAddress(socket_path, address, error)) {
+        return false;
+    }
+
+    // A socket nobody answers on is left over from a server that died
+    std::string connect_error;
+    int existing = connectTo(socket_path, connect_error);
+    if (existing >= 0) {
+        ::close(existing);
+        error = "a server is already listening on " + socket_path;
+        return false;
+    }
+    // Never remove anything but a socket: the path may be a user's file
+    struct stat info;
+    if (lstat(socket_path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            error = socket_path + ": path exists and is not a socket";
+            return false;
+        }
+        unlink(socket_path.c_str());
+    }
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        error = std::string("cannot listen on ") + socket_path + ": " + std::strerror(errno);
+        if (listen_fd_ >= 0) ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    socket_path_ = socket_path;
+    return true;
+}
+
+void RenderServer::serve(std::ostream* log) {
+    std::vector<std::thread> workers;
+    workers.reserve(jobs_);
+    for (size_t i = 0; i < jobs_; ++i) {
+        workers.emplace_back(&RenderServer::workerLoop, this);
+    }
+
+    bool failing = false;
+    while (!stopping_) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (stopping_) break; // stop() shuts the socket down
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) continue;
+            // Out of descriptors or memory (EMFILE, ENFILE, ENOBUFS, ENOMEM):
+            // clients still in the backlog are accepted once some finish
+            ++accept_errors_;
+            if (!failing && log) {
+                *log << "docgen serve: cannot accept a client: " << std::strerror(errno) << ", retrying\n"
+                     << std::flush;
+            }
+            failing = true;
+            std::this_thread::sleep_for(kAcceptBackoff);
+            continue;
+        }
+        failing = false;
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        if (stopping_) {
+            ::close(fd);
+            break;
+        }
+        waiting_clients_.push_back(fd);
+        open_clients_.insert(fd);
+        clients_ready_.notify_one();
+    }
+
+    stop();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    ::close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(socket_path_.c_str());
+}
+
+void RenderServer::stop() {
+    std::lock_guard<std::mutex> lock(clients_mutex_);
+    stopping_ = true;
+    if (listen_fd_ >= 0) {
+        shutdown(listen_fd_, SHUT_RDWR); // Wakes accept()
+    }
+    for (int fd : open_clients_) {
+        shutdown(fd, SHUT_RDWR); // Wakes a worker waiting for the next request
+    }
+    clients_ready_.notify_all();
+}
+
+void RenderServer::workerLoop() {
+    while (true) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(clients_mutex_);
+            clients_ready_.wait(lock, [this]() { return stopping_ || !waiting_clients_.empty(); });
+            if (waiting_clients_.empty()) {
+                return;
+            }
+            fd = waiting_clients_.front();
+            waiting_clients_.pop_front();
+            if (stopping_) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        serveClient(fd);
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        open_clients_.erase(fd);
+        ::close(fd);
+    }
+}
+
+void RenderServer::serveClient(int fd) {
+    SocketReader reader(fd);
+    std::string line;
+    std::string content;
+    std::string document;
+    while (reader.readLine(line, kMaxLineBytes)) {
+        std::string error;
+        size_t length = 0;
+        bool ok = contentLength(line, length);
+        if (!ok) {
+            error = "malformed request";
+        } else if (length > kMaxContentBytes) {
+            error = "request too large";
+            ok = false;
+        } else if (length > 0 && !reader.readBytes(length, content)) {
+            return;
+        }
+        if (!ok) {
+            sendAll(fd, "error " + error + "\n");
+            return; // The rest of the stream cannot be trusted
+        }
+
+        if (handle(line, length > 0 ? std::string_view(content) : std::string_view(), document, error)) {
+            std::string header = "ok " + std::to_string(document.size()) + "\n";
+            if (!sendAll(fd, header) || !sendAll(fd, document)) {
+                return;
+            }
+        } else if (!sendAll(fd, "error " + error + "\n")) {
+            return;
+        }
+    }
+}
+
+// ----- Requests -----
+bool RenderServer::contentLength(std::string_view line, size_t& length) {
+    std::string_view format, kind, argument;
+    if (!splitRequest(line, format, kind, argument)) {
+        return false;
+    }
+    length = 0;
+    if (kind == "path") {
+        return true;
+    }
+    return kind == "content" && parseSize(argument, length);
+}
+
+bool RenderServer::handle(std::string_view line, std::string_view content, std::string& document,
+                          std::string& error) {
+    std::string_view format_name, kind, argument;
+    ExportFormat format;
+    if (!splitRequest(line, format_name, kind, argument)) {
+        error = "malformed request";
+        return false;
+    }
+    if (!parseFormat(format_name, format)) {
+        error = "unknown format " + std::string(format_name);
+        return false;
+    }
+
+    std::shared_ptr<CachedSet> cached;
+    if (kind == "path") {
+        std::string path(argument);
+        cached = setForPath(path);
+        std::unique_lock<std::mutex> lock(cached->mutex);
+        if (!cached->set.load(path, 1)) {
+            lock.unlock();
+            dropPathSet(path, cached); // Do not keep entries for paths that no longer load
+            error = "cannot load " + path;
+            return false;
+        }
+        document = cached->set.render(format);
+        return true;
+    }
+
+    // Identical inline contents share one warm set
+    uint64_t hash = hashBytes(content);
+    cached = findContentSet(hash);
+    if (!cached) {
+        auto parsed = std::make_shared<CachedSet>();
+        if (!parsed->set.parse(content)) {
+            error = "invalid set data";
+            return false;
+        }
+        cached = addContentSet(hash, std::move(parsed));
+    }
+    std::lock_guard<std::mutex> lock(cached->mutex);
+    document = cached->set.render(format);
+    return true;
+}
+
+std::shared_ptr<RenderServer::CachedSet> RenderServer::setForPath(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = path_sets_.find(path);
+    if (it != path_sets_.end()) {
+        path_order_.splice(path_order_.end(), path_order_, it->second.order);
+        return it->second.set;
+    }
+    auto cached = std::make_shared<CachedSet>();
+    path_order_.push_back(path);
+    path_sets_.emplace(path, PathSet{cached, std::prev(path_order_.end())});
+    if (path_sets_.size() > kMaxPathSets) {
+        path_sets_.erase(path_order_.front()); // Users still holding it finish normally
+        path_order_.pop_front();
+    }
+    return cached;
+}
+
+void RenderServer::dropPathSet(const std::string& path, const std::shared_ptr<CachedSet>& set) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = path_sets_.find(path);
+    if (it != path_sets_.end() && it->second.set == set) {
+        path_order_.erase(it->second.order);
+        path_sets_.erase(it);
+    }
+}
+
+size_t RenderServer::pathSetCount() {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return path_sets_.size();
+}
+
+bool RenderServer::hasPathSet(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return path_sets_.count(path) != 0;
+}
+
+std::shared_ptr<RenderServer::CachedSet> RenderServer::findContentSet(uint64_t hash) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto it = content_sets_.find(hash);
+    return it == content_sets_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<RenderServer::CachedSet> RenderServer::addContentSet(uint64_t hash, std::shared_ptr<CachedSet> set) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    auto inserted = content_sets_.emplace(hash, std::move(set));
+    if (!inserted.second) {
+        return inserted.first->second; // Another client sent the same contents first
+    }
+    content_order_.push_back(hash);
+    if (content_order_.size() > kMaxContentSets) {
+        content_sets_.erase(content_order_.front()); // Users still holding it finish normally
+        content_order_.pop_front();
+    }
+    return inserted.first->second;
+}
+
+// ----- Client -----
+bool RenderServer::request(const std::string& socket_path, const std::string& line, std::string_view content,
+                           std::string& document, std::string& error) {
+    int fd = connectTo(socket_path, error);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = sendAll(fd, line + "\n") && sendAll(fd, content);
+    SocketReader reader(fd);
+    std::string status;
+    ok = ok && reader.readLine(status, kMaxLineBytes);
+    size_t length = 0;
+    if (!ok) {
+        error = "no answer from " + socket_path;
+    } else if (status.compare(0, 6, "error ") == 0) {
+        error = status.substr(6);
+        ok = false;
+    } else if (status.compare(0, 3, "ok ") != 0 || !parseSize(std::string_view(status).substr(3), length)) {
+        error = "malformed answer";
+        ok = false;
+    } else if (!reader.readBytes(length, document)) {
+        error = "answer cut short";
+        ok = false;
+    }
+    ::close(fd);
+    return ok;
+}
+
+// ----- Commands -----
+namespace {
+
+// Picks "--name value" / "--name=value" options; everything else is positional
+bool parseOptions(const std::vector<std::string>& args, std::map<std::string, std::string>& options,
+                  std::vector<std::string>& positional, std::string& error) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        size_t equals = arg.find('=');
+        if (equals != std::string::npos) {
+            options[arg.substr(0, equals)] = arg.substr(equals + 1);
+        } else if (i + 1 < args.size()) {
+            options[arg] = args[++i];
+        } else {
+            error = "missing value for " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* kServeUsage =
+    "Usage: docgen serve --socket PATH [--jobs N]\n"
+    "  Renders section sets for clients on a Unix socket until interrupted.\n"
+    "  --jobs N  worker threads (default: one per CPU)\n";
+
+const char* kRenderUsage =
+    "Usage: docgen render --socket PATH --format=adoc|md|html FILE\n"
+    "  Asks a running 'docgen serve' to render FILE and writes the document to stdout.\n";
+
+} // namespace
+
+int RenderServer::main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err) {
+    std::map<std::string, std::string> options;
+    std::vector<std::string> positional;
+    std::string error;
+    if (!parseOptions(args, options, positional, error) || options.count("--help")) {
+        if (!error.empty()) err << "docgen serve: " << error << "\n";
+        err << kServeUsage;
+        return 2;
+    }
+    size_t jobs = 0;
+    for (const auto& option : options) {
+        if (option.first == "--jobs") {
+            char* end = nullptr;
+            jobs = std::strtoul(option.second.c_str(), &end, 10);
+            if (option.second.empty() || *end != '\0' || option.second[0] == '-') error = "invalid job count";
+        } else if (option.first != "--socket") {
+            error = "unknown option " + option.first;
+        }
+    }
+    if (error.empty() && (!options.count("--socket") || !positional.empty())) {
+        error = "expected --socket PATH and nothing else";
+    }
+    if (!error.empty()) {
+        err << "docgen serve: " << error << "\n" << kServeUsage;
+        return 2;
+    }
+
+    // Signals are taken by one thread, which stops the server cleanly
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    RenderServer server(jobs);
+    if (!server.listen(options["--socket"], error)) {
+        err << "docgen serve: " << error << "\n";
+        return 1;
+    }
+    out << "Serving on " << options["--socket"] << " with " << server.jobs_ << " threads (Ctrl+C to stop)\n"
+        << std::flush;
+
+    std::atomic<bool> signalled{false};
+    std::thread signal_thread([&server, &signalled, signals]() {
+        int signal_number;
+        sigwait(&signals, &signal_number);
+        signalled = true;
+        server.stop();
+    });
+    server.serve(&err);
+    if (!signalled) {
+        pthread_kill(signal_thread.native_handle(), SIGTERM); // The server stopped on its own
+    }
+    signal_thread.join();
+    return 0;
+}
+
+int RenderServer::clientMain(const std::vector<std::string>& args, std::ostream& out, std::ostream& err) {
+    std::map<std::string, std::string> options;
+    std::vector<std::string> positional;
+    std::string error;
+    if (!parseOptions(args, options, positional, error) || !options.count("--socket") ||
+        !options.count("--format") || positional.size() != 1) {
+        if (!error.empty()) err << "docgen render: " << error << "\n";
+        err << kRenderUsage;
+        return 2;
+    }
+
+    // The server resolves relative paths against its own directory
+    std::string path = positional.front();
+    if (path[0] != '/') {
+        char* absolute = realpath(path.c_str(), nullptr);
+        if (absolute) {
+            path = absolute;
+            std::free(absolute);
+        }
+    }
+
+    std::string document;
+    if (!request(options["--socket"], options["--format"] + " path " + path, std::string_view(), document,
+                 error)) {
+        err << "docgen render: " << error << "\n";
+        return 1;
+    }
+    out << document << std::flush;
+    return 0;
+}
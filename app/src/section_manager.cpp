@@ -1,6 +1,7 @@
 #include "section_manager.h"
 #include "text_section.h"
-#include <algorithm>
+#include "set_file.h"
+#include "document_writer.h"
 #include <fstream>
 #include <string>
 #include <sstream>
@@ -11,11 +12,15 @@ static GtkTargetEntry target_list[] = {
 
 SectionManager::SectionManager(GtkWidget* text_container, GtkWidget* order_box)
     : text_container_(text_container), order_box_(order_box),
-      section_counter_(0), main_section_(nullptr),
+      main_section_(nullptr),
       main_order_button_(nullptr), main_text_view_(nullptr),
       dragged_widget_(nullptr), loaded_document_title_(""), dragged_source_index_(-1) {
     createMainSection();
     
+    // Frame-synced notifications tick on the text container's frame clock
+    frame_widget_ = text_container_;
+    g_object_add_weak_pointer(G_OBJECT(frame_widget_), reinterpret_cast<gpointer*>(&frame_widget_));
+    
     // Make order box a drop target for gaps between elements
     gtk_drag_dest_set(order_box_, (GtkDestDefaults)(GTK_DEST_DEFAULT_MOTION | GTK_DEST_DEFAULT_DROP), 
                       target_list, 1, GDK_ACTION_MOVE);
@@ -25,6 +30,10 @@ SectionManager::SectionManager(GtkWidget* text_container, GtkWidget* order_box)
 }
 
 SectionManager::~SectionManager() {
+    cancelScheduledNotify();
+    if (frame_widget_) {
+        g_object_remove_weak_pointer(G_OBJECT(frame_widget_), reinterpret_cast<gpointer*>(&frame_widget_));
+    }
     sections_.clear();
 }
 
@@ -140,63 +149,91 @@ void SectionManager::setupDragAndDrop(GtkWidget* order_button, int position) {
 }
 
 void SectionManager::addSection(const std::string& header, const std::string& content) {
-    section_counter_++;
+    // Widget defaults are level I and "text"
+    SectionData data;
+    data.header = header;
+    data.content = content;
+    addSectionFromData(std::move(data));
+}
+
+TextSection* SectionManager::addSectionFromData(SectionData data) {
+    // Values the widgets cannot represent fall back to the widget defaults
+    if (data.level < 1 || data.level > 3) {
+        data.level = 1;
+    }
+    if (data.type != "text" && data.type != "quote" && data.type != "box") {
+        data.type = "text";
+    }
     
-    auto section = std::make_unique<TextSection>(section_counter_, header);
-    section->setManager(this);
+    size_t index = model_.append(std::move(data));
+    const SectionData& stored = model_.at(index);
+    uint64_t id = stored.id;
+    int position = static_cast<int>(index) + 1;
     
-    if (!content.empty()) {
-        section->setContent(content);
+    auto section = std::make_unique<TextSection>(position, stored.header);
+    
+    // Populate the view before binding it so the model is not re-synced.
+    // Bodies still in a mapped set file are left there until first drawn.
+    if (!stored.isContentLoaded()) {
+        section->setContentPending();
+    } else if (!stored.content.empty()) {
+        section->setContent(stored.content);
     }
+    section->setHeadline(stored.headline);
+    section->setHeadlineLevel(stored.level);
+    section->setSectionType(stored.type);
+    
+    section->setId(id);
+    section->setManager(this);
     
     // Add to containers
     gtk_box_pack_start(GTK_BOX(text_container_), section->getContainer(), FALSE, TRUE, 5);
     gtk_box_pack_start(GTK_BOX(order_box_), section->getOrderButton(), FALSE, FALSE, 0);
     
     // Setup drag and drop
-    setupDragAndDrop(section->getOrderButton(), section_counter_);
+    setupDragAndDrop(section->getOrderButton(), position);
     
     section->show();
+    TextSection* view = section.get();
+    sections_by_id_[id] = view;
+    sections_by_widget_[view->getContainer()] = view;
+    sections_by_widget_[view->getOrderButton()] = view;
     sections_.push_back(std::move(section));
     
     // Notify content changed
-    if (on_content_changed_) {
-        on_content_changed_();
-    }
+    notifyContentChanged();
+    return view;
 }
 
 void SectionManager::deleteSection(TextSection* section) {
     if (!section) return;
     
-    // Find the section in our vector
-    auto it = std::find_if(sections_.begin(), sections_.end(),
-                          [section](const std::unique_ptr<TextSection>& ptr) {
-                              return ptr.get() == section;
-                          });
+    int index = indexOf(section);
+    if (index < 0) return;
     
-    if (it != sections_.end()) {
-        // Remove widgets from containers
-        GtkWidget* container = (*it)->getContainer();
-        GtkWidget* order_button = (*it)->getOrderButton();
-        
-        if (container && gtk_widget_get_parent(container)) {
-            gtk_container_remove(GTK_CONTAINER(text_container_), container);
-        }
-        if (order_button && gtk_widget_get_parent(order_button)) {
-            gtk_container_remove(GTK_CONTAINER(order_box_), order_button);
-        }
-        
-        // Remove from vector (this will destroy the unique_ptr and the object)
-        sections_.erase(it);
-        
-        // Notify content changed
-        if (on_content_changed_) {
-            on_content_changed_();
-        }
+    // Remove widgets from containers
+    GtkWidget* container = section->getContainer();
+    GtkWidget* order_button = section->getOrderButton();
+    
+    if (container && gtk_widget_get_parent(container)) {
+        gtk_container_remove(GTK_CONTAINER(text_container_), container);
+    }
+    if (order_button && gtk_widget_get_parent(order_button)) {
+        gtk_container_remove(GTK_CONTAINER(order_box_), order_button);
     }
+    
+    // Remove from indexes, model and vector (this will destroy the unique_ptr and the object)
+    unindexSection(section);
+    model_.erase(static_cast<size_t>(index));
+    sections_.erase(sections_.begin() + index);
+    
+    // Notify content changed
+    notifyContentChanged();
 }
 
 void SectionManager::clearAll() {
+    UpdateScope scope(*this);
+    
     // Clear main section
     GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(main_text_view_));
     gtk_text_buffer_set_text(buffer, "", -1);
@@ -217,15 +254,13 @@ void SectionManager::clearAll() {
     }
     
     // Remove all sections
+    sections_by_id_.clear();
+    sections_by_widget_.clear();
     sections_.clear();
-    
-    // Reset counter
-    section_counter_ = 0;
+    model_.clear();
     
     // Notify content changed
-    if (on_content_changed_) {
-        on_content_changed_();
-    }
+    notifyContentChanged();
 }
 
 void SectionManager::showMainSection() {
@@ -242,379 +277,59 @@ void SectionManager::hideMainSection() {
 
 std::vector<std::pair<std::string, std::string>> SectionManager::getSectionsInOrder() const {
     std::vector<std::pair<std::string, std::string>> result;
+    result.reserve(model_.size());
     
-    // Get sections in current display order
-    GList* text_children = gtk_container_get_children(GTK_CONTAINER(text_container_));
-    
-    for (GList* l = text_children; l != NULL; l = l->next) {
-        GtkWidget* section_widget = GTK_WIDGET(l->data);
-        
-        // Skip main section
-        if (section_widget == main_section_) {
-            continue;
-        }
-        
-        // Find corresponding TextSection object
-        for (const auto& section : sections_) {
-            if (section->getContainer() == section_widget) {
-                result.push_back({section->getHeader(), ""});
-                break;
-            }
-        }
+    // The model is kept in display order. Bodies are left out, as before:
+    // copying them would load every lazy body; read them through getModel()
+    for (const auto& section : model_.sections()) {
+        result.push_back({section.header, ""});
     }
     
-    g_list_free(text_children);
     return result;
 }
 
 std::string SectionManager::generateAsciiDoc(const std::string& title) const {
-    std::string result;
-    
-    // Add document title if provided
-    if (!title.empty()) {
-        result = "= " + title + "\n\n";
-    }
-    
-    // Get sections in current order
-    GList* text_children = gtk_container_get_children(GTK_CONTAINER(text_container_));
-    
-    for (GList* l = text_children; l != NULL; l = l->next) {
-        GtkWidget* section_widget = GTK_WIDGET(l->data);
-        
-        // Skip main section
-        if (section_widget == main_section_) {
-            continue;
-        }
-        
-        // Find corresponding TextSection object
-        for (const auto& section : sections_) {
-            if (section->getContainer() == section_widget) {
-                std::string header = section->getHeader();
-                std::string headline = section->getHeadline();
-                int level = section->getHeadlineLevel();
-                
-                // Use headline if provided, otherwise use default
-                // Only output heading if headline is not empty
-                std::string heading_marker;
-                if (!headline.empty()) {
-                    switch (level) {
-                        case 1:
-                            heading_marker = "== ";  // Level 1 heading
-                            break;
-                        case 2:
-                            heading_marker = "=== ";  // Level 2 heading
-                            break;
-                        case 3:
-                            heading_marker = "==== ";  // Level 3 heading
-                            break;
-                        default:
-                            heading_marker = "=== ";  // Default to level 2
-                    }
-                }
-
-                GList* section_children = gtk_container_get_children(GTK_CONTAINER(section->getContainer()));
-                GtkWidget* scrolled = nullptr;
-                for (GList* sc = section_children; sc != NULL; sc = sc->next) {
-                    if (GTK_IS_SCROLLED_WINDOW(sc->data)) {
-                        scrolled = GTK_WIDGET(sc->data);
-                        break;
-                    }
-                }
-                g_list_free(section_children);
-
-                if (scrolled) {
-                    GtkWidget* text_view_widget = gtk_bin_get_child(GTK_BIN(scrolled));
-                    if (GTK_IS_TEXT_VIEW(text_view_widget)) {
-                        GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_widget));
-                        GtkTextIter start, end;
-                        gtk_text_buffer_get_bounds(buffer, &start, &end);
-                        gchar* content = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
-
-                        std::string section_type = section->getSectionType();
-
-                        // Write AsciiDoc section with custom headline and level
-                        if (!headline.empty()) {
-                            result += heading_marker + headline + "\n\n";
-                        } else {
-                            result += heading_marker + header + "\n\n";
-                        }
-
-                        // Format content based on section type
-                        if (section_type == "quote") {
-                            // AsciiDoc quote block
-                            result += "[quote]\n____\n";
-                            result += std::string(content);
-                            result += "\n____\n\n";
-                        } else if (section_type == "box") {
-                            // AsciiDoc example/sidebar block
-                            result += "****\n";
-                            result += std::string(content);
-                            result += "\n****\n\n";
-                        } else {
-                            // Normal text
-                            result += std::string(content) + "\n\n";
-                        }
-
-                        g_free(content);
-                    }
-                }
-                break;
-            }
-        }
-    }
-    
-    g_list_free(text_children);
-    return result;
+    return fragment_cache_.generate(model_, FragmentFormat::AsciiDoc, title);
 }
 
 std::string SectionManager::generateMarkdown(const std::string& title) const {
-    std::string result;
-    
-    // Add document title if provided
-    if (!title.empty()) {
-        result = "# " + title + "\n\n";
-    }
-    
-    // Get sections in current order
-    GList* text_children = gtk_container_get_children(GTK_CONTAINER(text_container_));
-    
-    for (GList* l = text_children; l != NULL; l = l->next) {
-        GtkWidget* section_widget = GTK_WIDGET(l->data);
-        
-        // Skip main section
-        if (section_widget == main_section_) {
-            continue;
-        }
-        
-        // Find corresponding TextSection object
-        for (const auto& section : sections_) {
-            if (section->getContainer() == section_widget) {
-                std::string header = section->getHeader();
-                std::string headline = section->getHeadline();
-                int level = section->getHeadlineLevel();
-                
-                // Use headline if provided, otherwise use default
-                // Only output heading if headline is not empty
-                std::string heading_marker;
-                if (!headline.empty()) {
-                    switch (level) {
-                        case 1:
-                            heading_marker = "## ";  // Level 1 heading
-                            break;
-                        case 2:
-                            heading_marker = "### ";  // Level 2 heading
-                            break;
-                        case 3:
-                            heading_marker = "#### ";  // Level 3 heading
-                            break;
-                        default:
-                            heading_marker = "### ";  // Default to level 2
-                    }
-                }
-
-                GList* section_children = gtk_container_get_children(GTK_CONTAINER(section->getContainer()));
-                GtkWidget* scrolled = nullptr;
-                for (GList* sc = section_children; sc != NULL; sc = sc->next) {
-                    if (GTK_IS_SCROLLED_WINDOW(sc->data)) {
-                        scrolled = GTK_WIDGET(sc->data);
-                        break;
-                    }
-                }
-                g_list_free(section_children);
-
-                if (scrolled) {
-                    GtkWidget* text_view_widget = gtk_bin_get_child(GTK_BIN(scrolled));
-                    if (GTK_IS_TEXT_VIEW(text_view_widget)) {
-                        GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_widget));
-                        GtkTextIter start, end;
-                        gtk_text_buffer_get_bounds(buffer, &start, &end);
-                        gchar* content = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
-
-                        std::string section_type = section->getSectionType();
-
-                        // Write Markdown section with custom headline and level
-                        if (!headline.empty()) {
-                            result += heading_marker + headline + "\n\n";
-                        }
-
-                        // Format content based on section type
-                        if (section_type == "quote") {
-                            // Markdown blockquote
-                            std::string quote_content = std::string(content);
-                            std::string line;
-                            std::istringstream stream(quote_content);
-                            while (std::getline(stream, line)) {
-                                result += "> " + line + "\n";
-                            }
-                            result += "\n";
-                        } else if (section_type == "box") {
-                            // Markdown doesn't have native boxes, use code block as alternative
-                            result += "```\n";
-                            result += std::string(content);
-                            result += "\n```\n\n";
-                        } else {
-                            // Normal text
-                            result += std::string(content) + "\n\n";
-                        }
-
-                        g_free(content);
-                    }
-                }
-                break;
-            }
-        }
-    }
-    
-    g_list_free(text_children);
-    return result;
+    return fragment_cache_.generate(model_, FragmentFormat::Markdown, title);
 }
 
-bool SectionManager::saveToFile(const std::string& filepath) const {
-    std::ofstream file(filepath);
-    if (!file.is_open()) {
-        return false;
-    }
-    
-    // Save document title (stored separately by main window, so we don't save it here)
-    // The main window will need to handle this
-    
-    // Get sections in current order
-    GList* text_children = gtk_container_get_children(GTK_CONTAINER(text_container_));
-    
-    for (GList* l = text_children; l != NULL; l = l->next) {
-        GtkWidget* section_widget = GTK_WIDGET(l->data);
-        
-        // Skip main section
-        if (section_widget == main_section_) {
-            continue;
-        }
-        
-        // Find corresponding TextSection object
-        for (const auto& section : sections_) {
-            if (section->getContainer() == section_widget) {
-                std::string header = section->getHeader();
-                
-                // Navigate widget tree to find text view
-                GList* section_children = gtk_container_get_children(GTK_CONTAINER(section->getContainer()));
-                GtkWidget* scrolled = nullptr;
-                for (GList* sc = section_children; sc != NULL; sc = sc->next) {
-                    if (GTK_IS_SCROLLED_WINDOW(sc->data)) {
-                        scrolled = GTK_WIDGET(sc->data);
-                        break;
-                    }
-                }
-                g_list_free(section_children);
-                
-                if (scrolled) {
-                    GtkWidget* text_view_widget = gtk_bin_get_child(GTK_BIN(scrolled));
-                    if (GTK_IS_TEXT_VIEW(text_view_widget)) {
-                        GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_widget));
-                        GtkTextIter start, end;
-                        gtk_text_buffer_get_bounds(buffer, &start, &end);
-                        gchar* content = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
-                        
-                        std::string headline = section->getHeadline();
-                        int level = section->getHeadlineLevel();
-                        std::string section_type = section->getSectionType();
-                        
-                        // Write section header
-                        file << "[SECTION:" << header << "]\n";
-                        file << "[HEADLINE:" << headline << "]\n";
-                        file << "[LEVEL:" << level << "]\n";
-                        file << "[TYPE:" << section_type << "]\n";
-                        // Write content
-                        file << content << "\n";
-                        file << "[END_SECTION]\n\n";
-                        
-                        g_free(content);
-                    }
-                }
-                break;
-            }
-        }
-    }
-    
-    g_list_free(text_children);
-    file.close();
-    return true;
+std::string SectionManager::generateHtml(const std::string& title) const {
+    return fragment_cache_.generateHtmlPage(model_, title);
+}
+
+bool SectionManager::exportAsciiDoc(const std::string& filepath, const std::string& title) const {
+    return DocumentWriter<AsciiDocFormat>::writeFile(filepath, model_, title);
+}
+
+bool SectionManager::exportMarkdown(const std::string& filepath, const std::string& title) const {
+    return DocumentWriter<MarkdownFormat>::writeFile(filepath, model_, title);
+}
+
+bool SectionManager::saveToFile(const std::string& filepath, const std::string& document_title,
+                                SetFormat format) const {
+    return SetFile::save(filepath, model_, document_title, format);
 }
 
 bool SectionManager::loadFromFile(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
+    ParsedSet parsed;
+    if (!SetFile::load(filepath, parsed)) {
         return false;
     }
     
+    // One notification and one relayout for the whole set
+    UpdateScope scope(*this);
+    
     // Clear existing sections
     clearAll();
     
-    std::string line;
-    std::string current_header;
-    std::string current_headline;
-    int current_level = 2;
-    std::string current_type = "text";
-    std::string current_content;
-    std::string document_title;
-    bool in_section = false;
-    
-    while (std::getline(file, line)) {
-        if (line.find("[DOCUMENT_TITLE:") == 0) {
-            // Extract document title (will be handled by main window)
-            size_t start = line.find(":") + 1;
-            size_t end = line.find("]");
-            document_title = line.substr(start, end - start);
-        } else if (line.find("[SECTION:") == 0) {
-            // Extract header
-            size_t start = line.find(":") + 1;
-            size_t end = line.find("]");
-            current_header = line.substr(start, end - start);
-            current_content.clear();
-            current_headline.clear();
-            current_level = 2;
-            current_type = "text";
-            in_section = true;
-        } else if (line.find("[HEADLINE:") == 0) {
-            // Extract headline
-            size_t start = line.find(":") + 1;
-            size_t end = line.find("]");
-            current_headline = line.substr(start, end - start);
-        } else if (line.find("[LEVEL:") == 0) {
-            // Extract level
-            size_t start = line.find(":") + 1;
-            size_t end = line.find("]");
-            current_level = std::stoi(line.substr(start, end - start));
-        } else if (line.find("[TYPE:") == 0) {
-            // Extract type
-            size_t start = line.find(":") + 1;
-            size_t end = line.find("]");
-            current_type = line.substr(start, end - start);
-        } else if (line == "[END_SECTION]") {
-            if (in_section && !current_header.empty()) {
-                // Remove trailing newline if present
-                if (!current_content.empty() && current_content.back() == '\n') {
-                    current_content.pop_back();
-                }
-                addSection(current_header, current_content);
-                // Set headline, level, and type for the last added section
-                if (!sections_.empty()) {
-                    sections_.back()->setHeadline(current_headline);
-                    sections_.back()->setHeadlineLevel(current_level);
-                    sections_.back()->setSectionType(current_type);
-                }
-            }
-            in_section = false;
-            current_header.clear();
-            current_headline.clear();
-            current_level = 2;
-            current_type = "text";
-            current_content.clear();
-        } else if (in_section) {
-            current_content += line + "\n";
-        }
+    for (auto& section : parsed.sections) {
+        addSectionFromData(std::move(section));
     }
     
-    file.close();
-    loaded_document_title_ = document_title;
+    loaded_document_title_ = std::move(parsed.document_title);
     return true;
 }
 
@@ -630,11 +345,140 @@ void SectionManager::setOnContentChangedCallback(std::function<void()> callback)
 }
 
 void SectionManager::notifyContentChanged() {
+    if (update_depth_ > 0) {
+        update_changed_ = true;
+        return;
+    }
+    scheduleNotify();
+}
+
+void SectionManager::flushContentChanged() {
+    if (notify_source_id_ || notify_tick_id_) {
+        cancelScheduledNotify();
+        fireContentChanged();
+    }
+}
+
+void SectionManager::setNotifyDelay(guint milliseconds) {
+    notify_delay_ms_ = milliseconds;
+}
+
+void SectionManager::scheduleNotify() {
+    if (notify_delay_ms_ > 0) {
+        // Debounce: every change restarts the interval
+        cancelScheduledNotify();
+        notify_source_id_ = g_timeout_add(notify_delay_ms_, onNotifySource, this);
+        return;
+    }
+    if (notify_source_id_ || notify_tick_id_) {
+        return; // Already due this frame
+    }
+    if (frame_widget_ && gtk_widget_get_frame_clock(frame_widget_)) {
+        notify_tick_id_ = gtk_widget_add_tick_callback(frame_widget_, onNotifyTick, this, NULL);
+    } else {
+        // Not realized yet, so there is no frame clock to follow
+        notify_source_id_ = g_idle_add(onNotifySource, this);
+    }
+}
+
+void SectionManager::cancelScheduledNotify() {
+    if (notify_source_id_) {
+        g_source_remove(notify_source_id_);
+        notify_source_id_ = 0;
+    }
+    if (notify_tick_id_) {
+        if (frame_widget_) {
+            gtk_widget_remove_tick_callback(frame_widget_, notify_tick_id_);
+        }
+        notify_tick_id_ = 0;
+    }
+}
+
+void SectionManager::fireContentChanged() {
     if (on_content_changed_) {
         on_content_changed_();
     }
 }
 
+gboolean SectionManager::onNotifyTick(GtkWidget* /*widget*/, GdkFrameClock* /*clock*/, gpointer user_data) {
+    SectionManager* manager = static_cast<SectionManager*>(user_data);
+    manager->notify_tick_id_ = 0;
+    manager->fireContentChanged();
+    return G_SOURCE_REMOVE;
+}
+
+gboolean SectionManager::onNotifySource(gpointer user_data) {
+    SectionManager* manager = static_cast<SectionManager*>(user_data);
+    manager->notify_source_id_ = 0;
+    manager->fireContentChanged();
+    return G_SOURCE_REMOVE;
+}
+
+// ----- Batched Updates -----
+void SectionManager::beginUpdate() {
+    if (update_depth_++ > 0) {
+        return;
+    }
+    update_changed_ = false;
+    
+    // Packing into hidden containers skips the per-section map and relayout
+    hidden_text_container_ = gtk_widget_get_visible(text_container_);
+    hidden_order_box_ = gtk_widget_get_visible(order_box_);
+    if (hidden_text_container_) gtk_widget_hide(text_container_);
+    if (hidden_order_box_) gtk_widget_hide(order_box_);
+}
+
+void SectionManager::commitUpdate() {
+    if (update_depth_ == 0 || --update_depth_ > 0) {
+        return;
+    }
+    if (hidden_text_container_) gtk_widget_show(text_container_);
+    if (hidden_order_box_) gtk_widget_show(order_box_);
+    hidden_text_container_ = false;
+    hidden_order_box_ = false;
+    if (update_changed_) {
+        update_changed_ = false;
+        notifyContentChanged();
+    }
+}
+
+void SectionManager::onSectionEdited(TextSection* section) {
+    if (SectionData* data = model_.find(section->getId())) {
+        data->headline = section->getHeadline();
+        data->level = section->getHeadlineLevel();
+        data->type = section->getSectionType();
+        data->revision++;
+    }
+    notifyContentChanged();
+}
+
+void SectionManager::onSectionContentEdited(TextSection* section) {
+    if (SectionData* data = model_.find(section->getId())) {
+        data->setContent(section->getContent());
+    }
+    notifyContentChanged();
+}
+
+int SectionManager::indexOf(const TextSection* section) const {
+    // sections_ mirrors the model order, so the model's ID index gives the position
+    int index = model_.indexOf(section->getId());
+    if (index >= 0 && sections_[index].get() == section) {
+        return index;
+    }
+    return -1;
+}
+
+TextSection* SectionManager::sectionForWidget(GtkWidget* widget) const {
+    auto it = sections_by_widget_.find(widget);
+    return it != sections_by_widget_.end() ? it->second : nullptr;
+}
+
+void SectionManager::unindexSection(TextSection* section) {
+    sections_by_id_.erase(section->getId());
+    sections_by_widget_.erase(section->getContainer());
+    sections_by_widget_.erase(section->getOrderButton());
+}
+
 std::string SectionManager::getLoadedDocumentTitle() const {
     return loaded_document_title_;
 }
@@ -661,6 +505,15 @@ TextSection* SectionManager::getSectionAt(size_t index) const {
     return nullptr;
 }
 
+TextSection* SectionManager::findSection(uint64_t id) const {
+    auto it = sections_by_id_.find(id);
+    return it != sections_by_id_.end() ? it->second : nullptr;
+}
+
+const DocumentModel& SectionManager::getModel() const {
+    return model_;
+}
+
 // Static callback implementations
 void SectionManager::onDragBegin(GtkWidget* widget, GdkDragContext* context, gpointer user_data) {
     (void)context;
@@ -780,40 +633,42 @@ void SectionManager::onDragEnd(GtkWidget* widget, GdkDragContext* context, gpoin
     // Restore widget opacity
     gtk_widget_set_opacity(widget, 1.0);
     
-    // Sync text sections to match order box arrangement
+    // Sync text sections and the model to match order box arrangement.
+    // Order box and text container share positions (main section first).
     GList* order_children = gtk_container_get_children(GTK_CONTAINER(manager->order_box_));
-    GList* text_children = gtk_container_get_children(GTK_CONTAINER(manager->text_container_));
+    TextSection* dragged = manager->sectionForWidget(widget);
     
+    std::vector<size_t> order;
+    order.reserve(manager->sections_.size());
     gint position = 0;
     for (GList* order_l = order_children; order_l != NULL; order_l = order_l->next) {
-        GtkWidget* order_button = GTK_WIDGET(order_l->data);
-        
-        // Find matching text section
-        for (GList* text_l = text_children; text_l != NULL; text_l = text_l->next) {
-            GtkWidget* text_section = GTK_WIDGET(text_l->data);
-            
-            // Check if this text section's order button matches
-            for (size_t i = 0; i < manager->sections_.size(); ++i) {
-                if (manager->sections_[i]->getOrderButton() == order_button &&
-                    manager->sections_[i]->getContainer() == text_section) {
-                    gtk_box_reorder_child(GTK_BOX(manager->text_container_), text_section, position);
-                    break;
-                }
+        TextSection* section = manager->sectionForWidget(GTK_WIDGET(order_l->data));
+        if (section) {
+            order.push_back(static_cast<size_t>(manager->model_.indexOf(section->getId())));
+            // Only the dragged section moved; others only need moving if the main item did
+            if (!dragged || section == dragged) {
+                gtk_box_reorder_child(GTK_BOX(manager->text_container_), section->getContainer(), position);
             }
         }
         position++;
     }
-    
     g_list_free(order_children);
-    g_list_free(text_children);
+    
+    // The model checks the order first; a bad one leaves both lists as they were
+    if (order.size() == manager->sections_.size() && manager->model_.reorder(order)) {
+        std::vector<std::unique_ptr<TextSection>> reordered;
+        reordered.reserve(order.size());
+        for (size_t old_index : order) {
+            reordered.push_back(std::move(manager->sections_[old_index]));
+        }
+        manager->sections_ = std::move(reordered);
+    }
     
     manager->dragged_widget_ = nullptr;
     manager->dragged_source_index_ = -1;
     
     // Notify content changed after drag reordering
-    if (manager->on_content_changed_) {
-        manager->on_content_changed_();
-    }
+    manager->notifyContentChanged();
 }
 
 gboolean SectionManager::onOrderBoxDragMotion(GtkWidget* widget, GdkDragContext* context,
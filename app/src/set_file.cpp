@@ -0,0 +1,491 @@
+// =====================
+// SetFile.cpp
+// =====================
+// Implements memory-mapped .docgenset parsing and the v1/v2 writers
+// =====================
+
+#include "set_file.h"
+#include "file_sink.h"
+#include "parallel.h"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ----- Read-only Memory Mapping -----
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& filepath) {
+    close();
+
+    int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // mmap rejects zero-length mappings; an empty file is simply an empty view
+    if (st.st_size > 0) {
+        void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(addr);
+        size_ = static_cast<size_t>(st.st_size);
+        mapped_ = true;
+    }
+
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+}
+
+// ----- Parsing Helpers -----
+namespace {
+
+// v2 layout (all integers little-endian):
+//   header  : magic[8] u32 version, u32 flags, u64 section_count, u64 table_offset,
+//             u32 title_length, u32 reserved, followed by the title bytes
+//   table   : section_count x { u64 record_offset, u64 record_length } (8-byte aligned)
+//   record  : u8 level, u8 type, u16 reserved, u32 header_length, u32 headline_length,
+//             u32 reserved, u64 content_length, then header, headline and content bytes
+constexpr char kMagicV2[8] = {'D', 'G', 'S', 'E', 'T', 'v', '2', '\n'};
+constexpr uint32_t kVersion2 = 2;
+constexpr size_t kHeaderSize = 40;
+constexpr size_t kTableEntrySize = 16;
+constexpr size_t kRecordHeaderSize = 24;
+
+// Below these sizes thread startup costs more than parsing
+constexpr size_t kMinParallelBytes = 1 << 20;
+constexpr size_t kMinParallelSections = 1024;
+constexpr size_t kChunksPerJob = 4;
+
+const char* const kTypeNames[] = {"text", "quote", "box"};
+
+uint8_t typeCode(const std::string& type) {
+    if (type == "quote") return 1;
+    if (type == "box") return 2;
+    return 0;
+}
+
+uint32_t readU32(const char* p) {
+    const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(u[0]) | uint32_t(u[1]) << 8 | uint32_t(u[2]) << 16 | uint32_t(u[3]) << 24;
+}
+
+uint64_t readU64(const char* p) {
+    return uint64_t(readU32(p)) | uint64_t(readU32(p + 4)) << 32;
+}
+
+void putU32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+void putU64(char* p, uint64_t v) {
+    putU32(p, static_cast<uint32_t>(v));
+    putU32(p + 4, static_cast<uint32_t>(v >> 32));
+}
+
+bool startsWith(std::string_view line, std::string_view prefix) {
+    return line.size() >= prefix.size() && std::memcmp(line.data(), prefix.data(), prefix.size()) == 0;
+}
+
+// Value between the first ':' and the first ']' (or end of line)
+std::string_view markerValue(std::string_view line) {
+    size_t start = line.find(':') + 1;
+    size_t end = line.find(']');
+    if (end == std::string_view::npos || end < start) {
+        return line.substr(start);
+    }
+    return line.substr(start, end - start);
+}
+
+// Lenient integer parse (leading whitespace, optional sign); false if no digits
+bool parseLevel(std::string_view value, int& level) {
+    size_t i = 0;
+    while (i < value.size() && (value[i] == ' ' || value[i] == '\t')) i++;
+    bool negative = false;
+    if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+        negative = value[i] == '-';
+        i++;
+    }
+    if (i >= value.size() || value[i] < '0' || value[i] > '9') {
+        return false;
+    }
+    int result = 0;
+    while (i < value.size() && value[i] >= '0' && value[i] <= '9' && result < 100000) {
+        result = result * 10 + (value[i] - '0');
+        i++;
+    }
+    level = negative ? -result : result;
+    return true;
+}
+
+// Content is collected as runs of consecutive lines pointing into the mapping
+// and joined with '\n' into a single allocation when the section ends.
+struct ContentRuns {
+    std::vector<std::string_view> runs;
+
+    void addLine(std::string_view line) {
+        if (!runs.empty() && runs.back().data() + runs.back().size() + 1 == line.data()) {
+            std::string_view& last = runs.back();
+            last = std::string_view(last.data(), last.size() + 1 + line.size());
+        } else {
+            runs.push_back(line);
+        }
+    }
+
+    // A single run is one contiguous slice of the input
+    bool contiguous() const {
+        return runs.size() == 1;
+    }
+
+    std::string materialize() const {
+        std::string content;
+        if (runs.empty()) {
+            return content;
+        }
+        size_t total = runs.size() - 1;
+        for (const auto& run : runs) total += run.size();
+        content.reserve(total);
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (i > 0) content += '\n';
+            content.append(runs[i].data(), runs[i].size());
+        }
+        return content;
+    }
+};
+
+} // namespace
+
+// ----- v2 Random Access -----
+bool SetIndexReader::open(std::string_view data) {
+    data_ = std::string_view();
+    count_ = 0;
+    if (!SetFile::isIndexed(data) || data.size() < kHeaderSize) {
+        return false;
+    }
+    const char* base = data.data();
+    if (readU32(base + 8) != kVersion2) {
+        return false;
+    }
+    uint64_t count = readU64(base + 16);
+    uint64_t table_offset = readU64(base + 24);
+    uint64_t title_length = readU32(base + 32);
+    if (title_length > data.size() - kHeaderSize ||
+        table_offset > data.size() ||
+        count > (data.size() - table_offset) / kTableEntrySize) {
+        return false;
+    }
+    data_ = data;
+    title_ = data.substr(kHeaderSize, title_length);
+    count_ = static_cast<size_t>(count);
+    table_offset_ = static_cast<size_t>(table_offset);
+    return true;
+}
+
+bool SetIndexReader::section(size_t index, SectionView& out) const {
+    if (index >= count_) {
+        return false;
+    }
+    const char* entry = data_.data() + table_offset_ + index * kTableEntrySize;
+    uint64_t offset = readU64(entry);
+    uint64_t length = readU64(entry + 8);
+    if (offset > data_.size() || length > data_.size() - offset || length < kRecordHeaderSize) {
+        return false;
+    }
+    const char* record = data_.data() + offset;
+    uint8_t level = static_cast<uint8_t>(record[0]);
+    uint8_t type = static_cast<uint8_t>(record[1]);
+    uint64_t header_length = readU32(record + 4);
+    uint64_t headline_length = readU32(record + 8);
+    uint64_t content_length = readU64(record + 16);
+    uint64_t available = length - kRecordHeaderSize;
+    if (header_length > available || headline_length > available - header_length ||
+        content_length > available - header_length - headline_length) {
+        return false;
+    }
+    size_t pos = static_cast<size_t>(offset) + kRecordHeaderSize;
+    out.header = data_.substr(pos, header_length);
+    pos += header_length;
+    out.headline = data_.substr(pos, headline_length);
+    pos += headline_length;
+    out.content = data_.substr(pos, content_length);
+    out.level = level;
+    out.type = kTypeNames[type < 3 ? type : 0];
+    return true;
+}
+
+// ----- Loading -----
+bool SetFile::load(const std::string& filepath, ParsedSet& out, size_t jobs) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(filepath)) {
+        return false;
+    }
+    return parse(file->data(), out, file, jobs);
+}
+
+bool SetFile::parse(std::string_view data, ParsedSet& out, const Owner& owner, size_t jobs) {
+    if (isIndexed(data)) {
+        return parseV2(data, out, owner, jobs);
+    }
+    parseV1(data, out, owner, jobs);
+    return true;
+}
+
+bool SetFile::isIndexed(std::string_view data) {
+    return data.size() >= sizeof(kMagicV2) && std::memcmp(data.data(), kMagicV2, sizeof(kMagicV2)) == 0;
+}
+
+bool SetFile::parseV2(std::string_view data, ParsedSet& out, const Owner& owner, size_t jobs) {
+    SetIndexReader reader;
+    if (!reader.open(data)) {
+        return false;
+    }
+    out.document_title = std::string(reader.documentTitle());
+
+    // Records are independent, so each one is decoded straight into its slot
+    size_t base = out.sections.size();
+    out.sections.resize(base + reader.size());
+    std::atomic<bool> corrupt(false);
+    parallelFor(reader.size(), reader.size() >= kMinParallelSections ? jobs : 1, [&](size_t i) {
+        SectionView view;
+        if (!reader.section(i, view)) {
+            corrupt = true;
+            return;
+        }
+        SectionData& section = out.sections[base + i];
+        section.header = std::string(view.header);
+        section.headline = std::string(view.headline);
+        section.level = view.level;
+        section.type = std::string(view.type);
+        if (owner && !view.content.empty()) {
+            section.content_ref = view.content;
+            section.content_owner = owner;
+        } else {
+            section.content = std::string(view.content);
+        }
+    });
+    if (corrupt) {
+        out.sections.resize(base);
+        return false;
+    }
+    return true;
+}
+
+// ----- v1 Chunk Parsing -----
+namespace {
+
+// Parses one run of v1 lines; returns true if it contained a title marker
+bool parseV1Chunk(std::string_view data, ParsedSet& out, const SetFile::Owner& owner) {
+    bool saw_title = false;
+    SectionData current;
+    ContentRuns content;
+    bool in_section = false;
+
+    auto resetCurrent = [&]() {
+        current = SectionData();
+        current.level = 2;
+        content.runs.clear();
+    };
+    resetCurrent();
+
+    const char* pos = data.data();
+    const char* end = data.data() + data.size();
+    while (pos < end) {
+        const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        const char* line_end = newline ? newline : end;
+        std::string_view line(pos, line_end - pos);
+        pos = newline ? newline + 1 : end;
+
+        // Every marker starts with '['; anything else is content
+        if (line.empty() || line[0] != '[') {
+            if (in_section) content.addLine(line);
+            continue;
+        }
+
+        if (startsWith(line, "[DOCUMENT_TITLE:")) {
+            out.document_title = std::string(markerValue(line));
+            saw_title = true;
+        } else if (startsWith(line, "[SECTION:")) {
+            resetCurrent();
+            current.header = std::string(markerValue(line));
+            in_section = true;
+        } else if (startsWith(line, "[HEADLINE:")) {
+            current.headline = std::string(markerValue(line));
+        } else if (startsWith(line, "[LEVEL:")) {
+            parseLevel(markerValue(line), current.level);
+        } else if (startsWith(line, "[TYPE:")) {
+            current.type = std::string(markerValue(line));
+        } else if (line == "[END_SECTION]") {
+            if (in_section && !current.header.empty()) {
+                // Content split by marker lines has to be joined into a copy
+                if (owner && content.contiguous()) {
+                    current.content_ref = content.runs.front();
+                    current.content_owner = owner;
+                } else {
+                    current.content = content.materialize();
+                }
+                out.sections.push_back(std::move(current));
+            }
+            in_section = false;
+            resetCurrent();
+        } else if (in_section) {
+            content.addLine(line);
+        }
+    }
+    return saw_title;
+}
+
+// Splits v1 data into about `pieces` chunks, cutting only in front of
+// "[SECTION:" lines
+std::vector<std::string_view> splitAtSections(std::string_view data, size_t pieces) {
+    std::vector<std::string_view> chunks;
+    size_t target = std::max<size_t>(data.size() / pieces, 1);
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t cut = data.size();
+        if (data.size() - pos > target) {
+            size_t hit = data.find("\n[SECTION:", pos + target);
+            if (hit != std::string_view::npos) {
+                cut = hit + 1;
+            }
+        }
+        chunks.push_back(data.substr(pos, cut - pos));
+        pos = cut;
+    }
+    return chunks;
+}
+
+} // namespace
+
+void SetFile::parseV1(std::string_view data, ParsedSet& out, const Owner& owner, size_t jobs) {
+    jobs = resolveJobs(jobs);
+    if (data.size() < kMinParallelBytes || jobs <= 1) {
+        parseV1Chunk(data, out, owner);
+        return;
+    }
+
+    // A "[SECTION:" line resets all per-section state, so chunks that start
+    // at one parse independently; only the title can carry across chunks
+    std::vector<std::string_view> chunks = splitAtSections(data, jobs * kChunksPerJob);
+    std::vector<ParsedSet> parts(chunks.size());
+    std::vector<char> titled(chunks.size(), 0);
+    parallelFor(chunks.size(), jobs, [&](size_t i) {
+        titled[i] = parseV1Chunk(chunks[i], parts[i], owner);
+    });
+
+    size_t total = out.sections.size();
+    for (const auto& part : parts) total += part.sections.size();
+    out.sections.reserve(total);
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (titled[i]) {
+            out.document_title = std::move(parts[i].document_title);
+        }
+        for (auto& section : parts[i].sections) {
+            out.sections.push_back(std::move(section));
+        }
+    }
+}
+
+// ----- Saving -----
+bool SetFile::save(const std::string& filepath, const DocumentModel& model,
+                   const std::string& document_title, SetFormat format) {
+    // Truncating a file in place would fault any mapping of it; the sink
+    // writes a sibling temporary file and renames it into place
+    FileSink file;
+    if (!file.open(filepath)) {
+        return false;
+    }
+    if (format == SetFormat::V1) {
+        writeV1(file, model, document_title);
+    } else {
+        writeV2(file, model, document_title);
+    }
+    return file.commit();
+}
+
+void SetFile::writeV1(FileSink& out, const DocumentModel& model, const std::string& document_title) {
+    if (!document_title.empty()) {
+        out.append("[DOCUMENT_TITLE:");
+        out.append(document_title);
+        out.append("]\n");
+    }
+    for (const auto& section : model.sections()) {
+        out.append("[SECTION:");
+        out.append(section.header);
+        out.append("]\n[HEADLINE:");
+        out.append(section.headline);
+        out.append("]\n[LEVEL:");
+        out.append(std::to_string(section.level)); // Short, so copied
+        out.append("]\n[TYPE:");
+        out.append(section.type);
+        out.append("]\n");
+        out.append(section.body());
+        out.append("\n[END_SECTION]\n\n");
+    }
+}
+
+void SetFile::writeV2(FileSink& out, const DocumentModel& model, const std::string& document_title) {
+    const auto& sections = model.sections();
+    size_t title_end = kHeaderSize + document_title.size();
+    size_t table_offset = (title_end + 7) & ~size_t(7);
+
+    // Header, title and padding up to the table
+    std::string head(table_offset, '\0');
+    std::memcpy(&head[0], kMagicV2, sizeof(kMagicV2));
+    putU32(&head[8], kVersion2);
+    putU32(&head[12], 0);
+    putU64(&head[16], sections.size());
+    putU64(&head[24], table_offset);
+    putU32(&head[32], static_cast<uint32_t>(document_title.size()));
+    putU32(&head[36], 0);
+    std::memcpy(&head[kHeaderSize], document_title.data(), document_title.size());
+    out.append(head);
+
+    // Offset table
+    std::string table(sections.size() * kTableEntrySize, '\0');
+    uint64_t offset = table_offset + table.size();
+    for (size_t i = 0; i < sections.size(); ++i) {
+        const SectionData& section = sections[i];
+        uint64_t length = kRecordHeaderSize + section.header.size() + section.headline.size() + section.body().size();
+        putU64(&table[i * kTableEntrySize], offset);
+        putU64(&table[i * kTableEntrySize + 8], length);
+        offset += length;
+    }
+    out.append(table);
+    out.flush(); // Large enough to be referenced, and gone once this returns
+
+    // Length-prefixed section records
+    for (const auto& section : sections) {
+        char record[kRecordHeaderSize] = {};
+        record[0] = static_cast<char>(section.level);
+        record[1] = static_cast<char>(typeCode(section.type));
+        putU32(record + 4, static_cast<uint32_t>(section.header.size()));
+        putU32(record + 8, static_cast<uint32_t>(section.headline.size()));
+        std::string_view body = section.body();
+        putU64(record + 16, body.size());
+        out.append(std::string_view(record, kRecordHeaderSize));
+        out.append(section.header);
+        out.append(section.headline);
+        out.append(body);
+    }
+}
@@ -21,6 +21,9 @@ TextSection::TextSection(int position, const std::string& default_header)
 
 TextSection::~TextSection() {
     // GTK widgets are destroyed when their parent container is destroyed
+    if (load_idle_id_) {
+        g_source_remove(load_idle_id_);
+    }
 }
 
 // ----- UI Setup -----
@@ -184,6 +187,13 @@ void TextSection::createUI(const std::string& default_header) {
     gtk_text_view_set_bottom_margin(GTK_TEXT_VIEW(text_view_), 4);
     gtk_container_add(GTK_CONTAINER(scrolled_window_), text_view_);
 
+    // Keep the document model in sync with the buffer
+    g_signal_connect(gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_)), "changed",
+                     G_CALLBACK(onContentChanged), this);
+
+    // Pending content is loaded once the view is actually drawn (scrolled into view)
+    g_signal_connect(text_view_, "draw", G_CALLBACK(onTextViewDraw), this);
+
     gtk_box_pack_start(GTK_BOX(container_), scrolled_window_, FALSE, TRUE, 0);
 
     // Create order button as GtkButton for test compatibility
@@ -300,6 +310,19 @@ std::string TextSection::getSectionType() const {
     if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(type_box_))) return "box";
     return "text";
 }
+std::string TextSection::getContent() const {
+    if (content_pending_ && manager_) {
+        const SectionData* data = manager_->getModel().find(id_);
+        return data ? std::string(data->body()) : "";
+    }
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_));
+    GtkTextIter start, end;
+    gtk_text_buffer_get_bounds(buffer, &start, &end);
+    gchar* text = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+    std::string content = text ? std::string(text) : "";
+    g_free(text);
+    return content;
+}
 
 // ----- Data Setters -----
 void TextSection::setHeader(const std::string& header) {
@@ -308,6 +331,8 @@ void TextSection::setHeader(const std::string& header) {
     gtk_label_set_text(GTK_LABEL(order_label_), header.c_str());
 }
 void TextSection::setContent(const std::string& content) {
+    // Replacing the body makes any pending load obsolete
+    content_pending_ = false;
     GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_));
     gtk_text_buffer_set_text(buffer, content.c_str(), -1);
 }
@@ -330,6 +355,34 @@ void TextSection::setSectionType(const std::string& type) {
     else if (type == "box") gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(type_box_), TRUE);
 }
 
+// ----- Lazy Content -----
+void TextSection::setContentPending() {
+    content_pending_ = true;
+}
+
+void TextSection::ensureContentLoaded() {
+    if (load_idle_id_) {
+        g_source_remove(load_idle_id_);
+        load_idle_id_ = 0;
+    }
+    if (!content_pending_ || !manager_) {
+        return;
+    }
+    content_pending_ = false;
+
+    const SectionData* data = manager_->getModel().find(id_);
+    if (!data) {
+        return;
+    }
+
+    // The model already holds this body; don't echo it back as an edit
+    std::string_view body = data->body();
+    GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view_));
+    g_signal_handlers_block_by_func(buffer, (gpointer)onContentChanged, this);
+    gtk_text_buffer_set_text(buffer, body.data(), static_cast<gint>(body.size()));
+    g_signal_handlers_unblock_by_func(buffer, (gpointer)onContentChanged, this);
+}
+
 // ----- UI Visibility -----
 void TextSection::show() {
     gtk_widget_show_all(container_);
@@ -345,12 +398,12 @@ void TextSection::onRadioChanged(GtkToggleButton* button, gpointer user_data) {
     (void)button;
     TextSection* section = static_cast<TextSection*>(user_data);
     section->updateLevelIndicator();
-    if (section && section->manager_) section->manager_->notifyContentChanged();
+    if (section && section->manager_) section->manager_->onSectionEdited(section);
 }
 void TextSection::onTypeRadioChanged(GtkToggleButton* button, gpointer user_data) {
     (void)button;
     TextSection* section = static_cast<TextSection*>(user_data);
-    if (section && section->manager_) section->manager_->notifyContentChanged();
+    if (section && section->manager_) section->manager_->onSectionEdited(section);
 }
 void TextSection::onDeleteClicked(GtkButton* button, gpointer user_data) {
     (void)button;
@@ -359,7 +412,26 @@ void TextSection::onDeleteClicked(GtkButton* button, gpointer user_data) {
 }
 void TextSection::onHeadlineChanged(GtkEditable* /*editable*/, gpointer user_data) {
     TextSection* section = static_cast<TextSection*>(user_data);
-    if (section && section->manager_) section->manager_->notifyContentChanged();
+    if (section && section->manager_) section->manager_->onSectionEdited(section);
+}
+void TextSection::onContentChanged(GtkTextBuffer* /*buffer*/, gpointer user_data) {
+    TextSection* section = static_cast<TextSection*>(user_data);
+    if (section && section->manager_) section->manager_->onSectionContentEdited(section);
+}
+
+gboolean TextSection::onTextViewDraw(GtkWidget* /*widget*/, cairo_t* /*cr*/, gpointer user_data) {
+    TextSection* section = static_cast<TextSection*>(user_data);
+    // Changing the buffer mid-draw would invalidate the layout being drawn
+    if (section->content_pending_ && !section->load_idle_id_) {
+        section->load_idle_id_ = g_idle_add_full(G_PRIORITY_HIGH_IDLE, onLoadContentIdle, section, NULL);
+    }
+    return FALSE;
+}
+gboolean TextSection::onLoadContentIdle(gpointer user_data) {
+    TextSection* section = static_cast<TextSection*>(user_data);
+    section->load_idle_id_ = 0;
+    section->ensureContentLoaded();
+    return G_SOURCE_REMOVE;
 }
 
 // ----- UI Helpers -----
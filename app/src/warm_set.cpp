@@ -0,0 +1,88 @@
+// =====================
+// WarmSet.cpp
+// =====================
+// Implements the in-memory section set used by watch and serve modes
+// =====================
+
+#include "warm_set.h"
+#include "content_hash.h"
+#include <sys/stat.h>
+#include <unordered_map>
+#include <utility>
+
+// ----- Contents -----
+bool WarmSet::load(const std::string& filepath, size_t jobs) {
+    struct stat st;
+    if (stat(filepath.c_str(), &st) != 0) {
+        return false;
+    }
+    int64_t mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    if (static_cast<uint64_t>(st.st_ino) == file_inode_ && static_cast<uint64_t>(st.st_size) == file_size_ &&
+        mtime_ns == file_mtime_ns_) {
+        return true;
+    }
+
+    ParsedSet parsed;
+    if (!SetFile::load(filepath, parsed, jobs)) {
+        return false;
+    }
+    update(std::move(parsed));
+    file_inode_ = static_cast<uint64_t>(st.st_ino);
+    file_size_ = static_cast<uint64_t>(st.st_size);
+    file_mtime_ns_ = mtime_ns;
+    return true;
+}
+
+bool WarmSet::parse(std::string_view data) {
+    ParsedSet parsed;
+    if (!SetFile::parse(data, parsed)) {
+        return false;
+    }
+    update(std::move(parsed));
+    file_mtime_ns_ = -1; // No longer what any file holds
+    return true;
+}
+
+void WarmSet::update(ParsedSet parsed) {
+    // Sections that are unchanged keep their old ID and revision, so their
+    // cached fragments are reused wherever they moved to
+    std::unordered_multimap<uint64_t, size_t> previous; // Hash -> position in model_
+    for (size_t i = 0; i < section_hashes_.size(); ++i) {
+        previous.emplace(section_hashes_[i], i);
+    }
+    DocumentModel model;
+    std::vector<uint64_t> hashes;
+    hashes.reserve(parsed.sections.size());
+    content_hash_ = hashField(parsed.document_title, kHashSeed);
+    for (SectionData& section : parsed.sections) {
+        uint64_t hash = hashSection(section);
+        content_hash_ = hashValue(hash, content_hash_);
+        auto match = previous.find(hash);
+        if (match != previous.end()) {
+            const SectionData& old = model_.at(match->second);
+            section.id = old.id;
+            section.revision = old.revision;
+            previous.erase(match);
+        } else {
+            section.id = next_id_++;
+        }
+        hashes.push_back(hash);
+        model.append(std::move(section));
+    }
+    model_ = std::move(model);
+    section_hashes_ = std::move(hashes);
+    title_ = std::move(parsed.document_title);
+}
+
+// ----- Rendering -----
+std::string WarmSet::render(ExportFormat format) {
+    switch (format) {
+        case ExportFormat::AsciiDoc:
+            return cache_.generate(model_, FragmentFormat::AsciiDoc, title_);
+        case ExportFormat::Markdown:
+            return cache_.generate(model_, FragmentFormat::Markdown, title_);
+        case ExportFormat::Html:
+            return cache_.generateHtmlDocument(model_, title_);
+    }
+    return std::string();
+}
@@ -0,0 +1,300 @@
+// =====================
+// WatchExport.cpp
+// =====================
+// Implements watch mode
+// =====================
+
+#include "watch_export.h"
+#include "content_hash.h"
+#include "file_sink.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <dirent.h>
+#include <set>
+#include <sys/stat.h>
+#include <gio/gio.h>
+#include <glib-unix.h>
+
+namespace {
+
+bool isSetPath(const std::string& path) {
+    static const std::string extension = ".docgenset";
+    return path.size() > extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void printResult(const BatchResult& result, std::ostream& out, std::ostream& err) {
+    char timing[32];
+    std::snprintf(timing, sizeof(timing), "%9.1f ms  ", result.milliseconds);
+    if (!result.ok) {
+        err << timing << result.input << ": " << result.error << "\n";
+    } else if (result.removed) {
+        out << timing << result.input << " removed";
+        if (!result.output.empty()) {
+            out << ", deleted " << result.output;
+        }
+        out << "\n";
+    } else if (result.skipped) {
+        out << timing << result.input << " unchanged\n";
+    } else {
+        out << timing << result.input << " -> " << result.output << " (" << result.sections << " sections)\n";
+    }
+}
+
+} // namespace
+
+// ----- Rebuilds -----
+WatchExport::WatchExport(BatchOptions options) : options_(std::move(options)) {
+}
+
+std::vector<BatchResult> WatchExport::rebuild(const std::vector<std::string>& set_paths) {
+    // The map is only changed here, before the workers start
+    std::vector<BatchResult> results(set_paths.size());
+    std::vector<WatchedSet*> states(set_paths.size(), nullptr);
+    for (size_t i = 0; i < set_paths.size(); ++i) {
+        struct stat st;
+        if (stat(set_paths[i].c_str(), &st) != 0) {
+            // Only an output this watch wrote is deleted with its set
+            results[i].input = set_paths[i];
+            results[i].ok = true;
+            results[i].removed = true;
+            std::string output = BatchExport::outputPath(options_, set_paths[i]);
+            if (sets_.erase(set_paths[i]) && std::remove(output.c_str()) == 0) {
+                results[i].output = output;
+            }
+            continue;
+        }
+        auto& state = sets_[set_paths[i]];
+        if (!state) {
+            state = std::make_unique<WatchedSet>();
+        }
+        states[i] = state.get();
+    }
+
+    // Each worker touches only its own set
+    size_t inner_jobs = set_paths.size() == 1 ? options_.jobs : 1;
+    parallelFor(set_paths.size(), options_.jobs, [&](size_t i) {
+        if (states[i]) {
+            results[i] = rebuildSet(set_paths[i], *states[i], inner_jobs);
+        }
+    });
+    return results;
+}
+
+BatchResult WatchExport::rebuildSet(const std::string& path, WatchedSet& watched, size_t jobs) {
+    BatchResult result;
+    result.input = path;
+    result.output = BatchExport::outputPath(options_, path);
+    auto start = std::chrono::steady_clock::now();
+
+    if (!watched.set.load(path, jobs)) {
+        result.error = "cannot load section set"; // Possibly mid-write; the next event retries
+        return result;
+    }
+    result.sections = watched.set.model().size();
+
+    uint64_t input_hash = hashValue(static_cast<uint64_t>(options_.format), watched.set.contentHash());
+    if (watched.written.isCurrent(result.output, input_hash)) {
+        result.ok = true;
+        result.skipped = true;
+    } else {
+        std::string text = watched.set.render(options_.format);
+        FileSink sink;
+        result.ok = sink.open(result.output, text.size());
+        if (result.ok) {
+            sink.append(text);
+            result.ok = sink.commit();
+        }
+        if (result.ok) {
+            watched.written.record(result.output, input_hash);
+        } else {
+            result.error = "cannot write " + result.output;
+        }
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    result.milliseconds = elapsed.count();
+    return result;
+}
+
+size_t WatchExport::renderCount() const {
+    size_t renders = 0;
+    for (const auto& set : sets_) {
+        renders += set.second->set.renderCount();
+    }
+    return renders;
+}
+
+std::vector<std::string> WatchExport::listSets(const std::string& dir) {
+    std::vector<std::string> paths;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return paths;
+    }
+    std::string prefix = dir.empty() || dir.back() == '/' ? dir : dir + "/";
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (isSetPath(name)) {
+            paths.push_back(prefix + name);
+        }
+    }
+    closedir(handle);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// ----- Command -----
+namespace {
+
+// Main loop state: changed paths collect until events pause for kDebounceMs
+struct WatchLoop {
+    WatchExport* exporter;
+    std::set<std::string> pending;
+    std::ostream& out;
+    std::ostream& err;
+    guint timer = 0;
+    GMainLoop* loop = nullptr;
+};
+
+void addPending(WatchLoop* watch, GFile* file) {
+    if (!file) {
+        return;
+    }
+    char* path = g_file_get_path(file);
+    if (path && isSetPath(path)) {
+        watch->pending.insert(path);
+    }
+    g_free(path);
+}
+
+gboolean onSettled(gpointer user_data) {
+    WatchLoop* watch = static_cast<WatchLoop*>(user_data);
+    watch->timer = 0;
+    std::vector<std::string> paths(watch->pending.begin(), watch->pending.end());
+    watch->pending.clear();
+
+    size_t renders = watch->exporter->renderCount();
+    for (const BatchResult& result : watch->exporter->rebuild(paths)) {
+        printResult(result, watch->out, watch->err);
+    }
+    watch->out << "  " << watch->exporter->renderCount() - renders << " fragments rendered\n" << std::flush;
+    return G_SOURCE_REMOVE;
+}
+
+void onDirectoryChanged(GFileMonitor* monitor, GFile* file, GFile* other_file, GFileMonitorEvent event,
+                        gpointer user_data) {
+    (void)monitor;
+    WatchLoop* watch = static_cast<WatchLoop*>(user_data);
+    switch (event) {
+        case G_FILE_MONITOR_EVENT_RENAMED: // A save renames its temporary file over the set
+            addPending(watch, file);
+            addPending(watch, other_file);
+            break;
+        case G_FILE_MONITOR_EVENT_CHANGED:
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_CREATED:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_IN:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+            addPending(watch, file);
+            break;
+        default:
+            return;
+    }
+    if (watch->pending.empty()) {
+        return;
+    }
+
+    // Every event restarts the quiet period, so a burst of writes rebuilds once
+    if (watch->timer) {
+        g_source_remove(watch->timer);
+    }
+    watch->timer = g_timeout_add(WatchExport::kDebounceMs, onSettled, watch);
+}
+
+gboolean onInterrupt(gpointer user_data) {
+    g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+    return G_SOURCE_REMOVE;
+}
+
+} // namespace
+
+int WatchExport::main(const std::vector<std::string>& args, std::ostream& out, std::ostream& err) {
+    for (const std::string& arg : args) {
+        if (arg == "--help" || arg == "-h") {
+            out << usage();
+            return 0;
+        }
+    }
+
+    BatchOptions options;
+    std::string error;
+    if (!BatchExport::parseArguments(args, options, error)) {
+        err << "docgen watch: " << error << "\n" << usage();
+        return 2;
+    }
+    if (options.incremental) {
+        // Watch mode always leaves unchanged outputs alone; the flag would do nothing
+        err << "docgen watch: --incremental is not supported\n" << usage();
+        return 2;
+    }
+    if (options.inputs.size() != 1 || !isDirectory(options.inputs.front())) {
+        err << "docgen watch: expected one directory of section sets\n" << usage();
+        return 2;
+    }
+    std::string dir = options.inputs.front();
+    WatchExport exporter(options);
+
+    // Initial build of everything, on all worker threads
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = exporter.rebuild(listSets(dir));
+    for (const BatchResult& result : results) {
+        printResult(result, out, err);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    char total[32];
+    std::snprintf(total, sizeof(total), "%.1f ms", elapsed.count());
+    out << results.size() << " sets exported in " << total << "; watching " << dir << " (Ctrl+C to stop)\n"
+        << std::flush;
+
+    GFile* directory = g_file_new_for_path(dir.c_str());
+    GError* monitor_error = NULL;
+    GFileMonitor* monitor = g_file_monitor_directory(directory, G_FILE_MONITOR_WATCH_MOVES, NULL, &monitor_error);
+    g_object_unref(directory);
+    if (!monitor) {
+        err << "docgen watch: cannot watch " << dir << ": " << monitor_error->message << "\n";
+        g_error_free(monitor_error);
+        return 1;
+    }
+    g_file_monitor_set_rate_limit(monitor, WatchExport::kDebounceMs);
+
+    WatchLoop watch{&exporter, {}, out, err};
+    watch.loop = g_main_loop_new(NULL, FALSE);
+    g_signal_connect(monitor, "changed", G_CALLBACK(onDirectoryChanged), &watch);
+    g_unix_signal_add(SIGINT, onInterrupt, watch.loop);
+    g_unix_signal_add(SIGTERM, onInterrupt, watch.loop);
+    g_main_loop_run(watch.loop);
+
+    if (watch.timer) {
+        g_source_remove(watch.timer);
+    }
+    g_signal_handlers_disconnect_by_data(monitor, &watch);
+    g_object_unref(monitor);
+    g_main_loop_unref(watch.loop);
+    return 0;
+}
+
+const char* WatchExport::usage() {
+    return "Usage: docgen watch --format=adoc|md|html [--jobs N] -o DIR SETDIR\n"
+           "  Exports every .docgenset in SETDIR to DIR, then re-exports each set when it changes.\n"
+           "  Unchanged sets are never rewritten; deleting a set deletes its output.\n"
+           "  --jobs N  worker threads (default: one per CPU)\n";
+}
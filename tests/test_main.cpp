@@ -2,9 +2,33 @@
 #include "text_viewer.h"
 #include "text_section.h"
 #include "section_manager.h"
+#include "batch_export.h"
+#include "book_file.h"
+#include "document_model.h"
+#include "document_writer.h"
+#include "export_job.h"
+#include "file_sink.h"
+#include "fragment_cache.h"
+#include "html_renderer.h"
+#include "preview_patcher.h"
+#include "preview_renderer.h"
+#include "render_server.h"
+#include "set_file.h"
+#include "warm_set.h"
+#include "watch_export.h"
 #include <gtk/gtk.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Initialize GTK for testing
 class GtkTestEnvironment : public ::testing::Environment {
@@ -685,6 +709,1156 @@ TEST_F(TextViewerTest, LoadFileWithUnicode) {
     std::remove("test_unicode.txt");
 }
 
+// DocumentModel Tests
+class DocumentModelTest : public ::testing::Test {
+protected:
+    DocumentModel model;
+
+    void addSection(const std::string& header, const std::string& headline,
+                    int level, const std::string& type, const std::string& content) {
+        SectionData data;
+        data.header = header;
+        data.headline = headline;
+        data.level = level;
+        data.type = type;
+        data.content = content;
+        model.append(data);
+    }
+};
+
+// Whole contents of a file written by a test
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+TEST_F(DocumentModelTest, GenerateAsciiDoc) {
+    addSection("a.txt", "Intro", 1, "text", "Hello");
+    addSection("b.txt", "", 2, "quote", "Quoted");
+    addSection("c.txt", "Boxed", 3, "box", "In a box");
+
+    EXPECT_EQ(model.generateAsciiDoc("Doc"),
+              "= Doc\n\n"
+              "== Intro\n\nHello\n\n"
+              "b.txt\n\n[quote]\n____\nQuoted\n____\n\n"
+              "==== Boxed\n\n****\nIn a box\n****\n\n");
+}
+
+TEST_F(DocumentModelTest, GenerateMarkdown) {
+    addSection("a.txt", "Intro", 1, "text", "Hello");
+    addSection("b.txt", "", 2, "quote", "Line 1\nLine 2\n");
+    addSection("c.txt", "Boxed", 2, "box", "In a box");
+
+    EXPECT_EQ(model.generateMarkdown("Doc"),
+              "# Doc\n\n"
+              "## Intro\n\nHello\n\n"
+              "> Line 1\n> Line 2\n\n"
+              "### Boxed\n\n```\nIn a box\n```\n\n");
+}
+
+TEST_F(DocumentModelTest, ReorderAndErase) {
+    addSection("first", "", 1, "text", "1");
+    addSection("second", "", 1, "text", "2");
+    addSection("third", "", 1, "text", "3");
+
+    EXPECT_TRUE(model.reorder({2, 0, 1}));
+    ASSERT_EQ(model.size(), 3u);
+    EXPECT_EQ(model.at(0).header, "third");
+    EXPECT_EQ(model.at(1).header, "first");
+    EXPECT_EQ(model.at(2).header, "second");
+
+    // Orders that are not a permutation leave the model untouched
+    EXPECT_FALSE(model.reorder({0, 1}));
+    EXPECT_FALSE(model.reorder({0, 0, 1}));
+    EXPECT_FALSE(model.reorder({0, 1, 3}));
+    EXPECT_EQ(model.at(0).header, "third");
+    EXPECT_EQ(model.at(1).header, "first");
+    EXPECT_EQ(model.at(2).header, "second");
+    EXPECT_EQ(model.indexOf(model.at(2).id), 2);
+
+    model.erase(1);
+    ASSERT_EQ(model.size(), 2u);
+    EXPECT_EQ(model.at(1).header, "second");
+}
+
+TEST_F(DocumentModelTest, StableIdsAndLookup) {
+    addSection("first", "", 1, "text", "1");
+    addSection("second", "", 1, "text", "2");
+    addSection("third", "", 1, "text", "3");
+
+    uint64_t first = model.at(0).id;
+    uint64_t third = model.at(2).id;
+    EXPECT_NE(first, 0u);
+    EXPECT_NE(first, third);
+
+    model.erase(1);
+    EXPECT_EQ(model.indexOf(third), 1);
+    model.reorder({1, 0});
+    EXPECT_EQ(model.indexOf(third), 0);
+    EXPECT_EQ(model.indexOf(first), 1);
+    ASSERT_NE(model.find(first), nullptr);
+    EXPECT_EQ(model.find(first)->header, "first");
+
+    // IDs are not reused after erase
+    addSection("fourth", "", 1, "text", "4");
+    EXPECT_NE(model.at(2).id, first);
+    EXPECT_NE(model.at(2).id, third);
+    EXPECT_EQ(model.indexOf(9999), -1);
+}
+
+TEST_F(DocumentModelTest, DocumentWriterSinksAgree) {
+    addSection("a.txt", "Intro", 7, "text", "Hello");
+    addSection("b.txt", "", 2, "quote", "Line 1\n\nLine 3\n");
+    addSection("c.txt", "Boxed", 3, "unknown", "Plain");
+
+    std::string markdown = DocumentWriter<MarkdownFormat>::render(model, "Doc");
+    EXPECT_EQ(markdown,
+              "# Doc\n\n"
+              "### Intro\n\nHello\n\n"
+              "> Line 1\n> \n> Line 3\n\n"
+              "#### Boxed\n\nPlain\n\n");
+    EXPECT_EQ(DocumentWriter<MarkdownFormat>::measure(model, "Doc"), markdown.size());
+
+    std::string appended;
+    DocumentWriter<AsciiDocFormat>::appendTitle("Doc", appended);
+    for (const auto& section : model.sections()) {
+        DocumentWriter<AsciiDocFormat>::appendSection(section, appended);
+    }
+    EXPECT_EQ(appended, model.generateAsciiDoc("Doc"));
+    EXPECT_EQ(DocumentWriter<AsciiDocFormat>::measure(model, ""), model.generateAsciiDoc().size());
+}
+
+TEST_F(DocumentModelTest, ParallelRenderMatchesSerial) {
+    for (int i = 0; i < 3000; ++i) {
+        addSection("s" + std::to_string(i) + ".txt", i % 4 ? "Head " + std::to_string(i) : "",
+                   i % 5, i % 3 == 0 ? "quote" : (i % 3 == 1 ? "box" : "text"),
+                   "Line " + std::to_string(i) + "\nnext\n");
+    }
+
+    std::string serial;
+    StringSink sink{serial};
+    DocumentWriter<MarkdownFormat>::writeDocument(sink, model, "Doc");
+    EXPECT_EQ(DocumentWriter<MarkdownFormat>::render(model, "Doc", 4), serial);
+    EXPECT_EQ(DocumentWriter<MarkdownFormat>::sectionOffsets(model, "Doc", 4).back(), serial.size());
+
+    std::string filename = "test_parallel_export.md";
+    ExportJob job(model, "Doc", filename, ExportFormat::Markdown, 4);
+    ASSERT_EQ(job.run(), ExportJob::Status::Done);
+    EXPECT_EQ(readFile(filename), serial);
+    std::remove(filename.c_str());
+}
+
+TEST_F(DocumentModelTest, FragmentCacheRendersOnlyEditedSections) {
+    addSection("a.txt", "Intro", 1, "text", "Hello");
+    addSection("b.txt", "", 2, "quote", "Line 1\nLine 2");
+    addSection("c.txt", "Boxed", 3, "box", "In a box");
+    FragmentCache cache;
+
+    EXPECT_EQ(cache.generate(model, FragmentFormat::Markdown, "Doc"), model.generateMarkdown("Doc"));
+    EXPECT_EQ(cache.generate(model, FragmentFormat::AsciiDoc, "Doc"), model.generateAsciiDoc("Doc"));
+    EXPECT_EQ(cache.renderCount(), 6u);
+
+    // Unchanged sections are reused
+    cache.generate(model, FragmentFormat::Markdown, "Other title");
+    EXPECT_EQ(cache.renderCount(), 6u);
+
+    model.at(1).setContent("Edited");
+    EXPECT_EQ(cache.generate(model, FragmentFormat::Markdown, "Doc"), model.generateMarkdown("Doc"));
+    EXPECT_EQ(cache.renderCount(), 7u);
+
+    // Entries of deleted sections are dropped
+    model.erase(0);
+    cache.generate(model, FragmentFormat::Markdown);
+    EXPECT_EQ(cache.size(), 2u);
+}
+
+TEST_F(DocumentModelTest, FragmentCacheHtmlMatchesHtmlWriter) {
+    addSection("a.txt", "Intro", 1, "text", "Hello\n```");
+    addSection("b.txt", "", 2, "quote", "Quoted");
+    addSection("c.txt", "Boxed", 3, "box", "In a box");
+    FragmentCache cache;
+
+    // The fence in the first section is plain text and does not affect the rest
+    std::string expected = htmlPageHead();
+    StringSink sink{expected};
+    HtmlWriter::writeDocument(sink, model, "Doc");
+    expected += htmlPageTail();
+    EXPECT_EQ(cache.generateHtmlPage(model, "Doc"), expected);
+    EXPECT_EQ(cache.generateHtmlPage(model, "Doc"), expected);
+    EXPECT_NE(expected.find("<p>Hello\n```</p>\n<blockquote>Quoted<br>\n"), std::string::npos);
+}
+
+TEST_F(DocumentModelTest, PreviewPatchSendsOnlyChangedBlocks) {
+    addSection("a.txt", "Intro", 1, "text", "Hello");
+    addSection("b.txt", "", 2, "quote", "Quoted");
+    addSection("c.txt", "", 1, "text", "More");
+    addSection("d.txt", "Boxed", 3, "box", "In a box");
+    FragmentCache cache;
+
+    // The title, then one block per section
+    std::vector<HtmlBlock> blocks = cache.generateHtmlBlocks(model, "Doc");
+    ASSERT_EQ(blocks.size(), 5u);
+    EXPECT_EQ(blocks[0].key, 0u);
+    EXPECT_EQ(blocks[1].key, model.at(0).id);
+    EXPECT_EQ(blocks[4].key, model.at(3).id);
+    std::string body;
+    for (const HtmlBlock& block : blocks) body += block.html;
+    std::string page = cache.generateHtmlPage(model, "Doc");
+    EXPECT_EQ(page, htmlPageHead() + body + htmlPageTail());
+
+    PreviewPatcher patcher;
+    EXPECT_NE(patcher.page(blocks).find("id=\"docgen-b" + std::to_string(model.at(3).id) + "\""), std::string::npos);
+    EXPECT_EQ(patcher.patch(cache.generateHtmlBlocks(model, "Doc")), "");
+
+    model.at(3).setContent("Edited </script>");
+    std::string script = patcher.patch(cache.generateHtmlBlocks(model, "Doc"));
+    EXPECT_EQ(script.compare(0, 17, "docgenPatch(null,"), 0);
+    EXPECT_NE(script.find("Edited &lt;/script&gt;"), std::string::npos);
+    EXPECT_EQ(script.compare(script.size() - 5, 5, ",{});"), 0);
+    EXPECT_EQ(script.find("Intro"), std::string::npos);
+
+    model.reorder({3, 0, 1, 2});
+    script = patcher.patch(cache.generateHtmlBlocks(model, "Doc"));
+    std::string order = "[\"0\"";
+    for (const auto& section : model.sections()) order += ",\"" + std::to_string(section.id) + "\"";
+    EXPECT_EQ(script, "docgenPatch(" + order + "],{},{});");
+}
+
+TEST_F(DocumentModelTest, PreviewPatchWindowsLargeDocuments) {
+    for (size_t i = 0; i < PreviewPatcher::kInitialBlocks + 100; ++i) {
+        addSection("s" + std::to_string(i) + ".txt", "Part " + std::to_string(i), 1, "text", "Line\nline");
+    }
+    FragmentCache cache;
+    PreviewPatcher patcher;
+
+    // Past the first blocks, the page only has placeholders of estimated height
+    std::vector<HtmlBlock> blocks = cache.generateHtmlBlocks(model, "Doc");
+    std::string page = patcher.page(blocks);
+    EXPECT_EQ(patcher.shownCount(), PreviewPatcher::kInitialBlocks);
+    EXPECT_NE(page.find("Part 10<"), std::string::npos);
+    EXPECT_EQ(page.find("Part 150<"), std::string::npos);
+    std::string far = std::to_string(model.at(150).id);
+    int height = PreviewPatcher::estimateHeight(blocks[151]);
+    EXPECT_GT(height, 0);
+    EXPECT_NE(page.find("id=\"docgen-b" + far + "\" style=\"height:" + std::to_string(height) + "px\""),
+              std::string::npos);
+
+    // An edit out of view only resizes the placeholder
+    model.at(150).setContent("Edited");
+    std::string script = patcher.patch(cache.generateHtmlBlocks(model, "Doc"));
+    EXPECT_EQ(script.compare(0, 20, "docgenPatch(null,{},"), 0);
+    EXPECT_EQ(script.find("Edited"), std::string::npos);
+
+    // Scrolled into view, it is filled with its current HTML and then patched
+    script = patcher.handleMessage("fill " + far + " 999999");
+    EXPECT_EQ(script.compare(0, 13 + far.size(), "docgenFill({\"" + far), 0);
+    EXPECT_NE(script.find("Edited"), std::string::npos);
+    EXPECT_EQ(script.find("999999"), std::string::npos);
+    EXPECT_EQ(patcher.shownCount(), PreviewPatcher::kInitialBlocks + 1);
+    model.at(150).setContent("Edited again");
+    EXPECT_NE(patcher.patch(cache.generateHtmlBlocks(model, "Doc")).find("Edited again"), std::string::npos);
+
+    // Dropped or deleted blocks are no longer shown
+    EXPECT_EQ(patcher.handleMessage("drop " + far), "");
+    model.erase(0);
+    patcher.patch(cache.generateHtmlBlocks(model, "Doc"));
+    EXPECT_EQ(patcher.shownCount(), PreviewPatcher::kInitialBlocks - 1);
+}
+
+TEST_F(DocumentModelTest, PreviewRendererDeliversNewestResult) {
+    for (int i = 0; i < 50; ++i) {
+        addSection("s" + std::to_string(i) + ".txt", "Part " + std::to_string(i), 1, "text", "Body");
+    }
+
+    // A cancelled render stops between sections and returns nothing
+    FragmentCache cache;
+    int polls = 0;
+    EXPECT_TRUE(cache.generateHtmlBlocks(model, "Doc", [&] { return ++polls > 3; }).empty());
+    EXPECT_EQ(polls, 4);
+
+    std::mutex mutex;
+    std::condition_variable delivered;
+    std::vector<uint64_t> generations;
+    std::vector<HtmlBlock> newest;
+    PreviewRenderer renderer([&](uint64_t generation, std::vector<HtmlBlock> blocks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        generations.push_back(generation);
+        newest = std::move(blocks);
+        delivered.notify_one();
+    });
+
+    // Back-to-back requests: older ones may be skipped, never delivered late
+    uint64_t last = 0;
+    for (int i = 0; i < 5; ++i) {
+        model.at(0).setContent("Edit " + std::to_string(i));
+        last = renderer.request(model, "Doc");
+    }
+    EXPECT_EQ(renderer.latest(), last);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(delivered.wait_for(lock, std::chrono::seconds(10),
+                                       [&] { return !generations.empty() && generations.back() == last; }));
+        EXPECT_TRUE(std::is_sorted(generations.begin(), generations.end()));
+        EXPECT_LE(generations.size(), 5u);
+    }
+
+    std::vector<HtmlBlock> expected = cache.generateHtmlBlocks(model, "Doc");
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(newest.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(newest[i].key, expected[i].key);
+        EXPECT_EQ(newest[i].hash, expected[i].hash);
+    }
+    EXPECT_NE(newest[1].html.find("Edit 4"), std::string::npos);
+}
+
+TEST_F(DocumentModelTest, PreviewRendererSendsOnlyChangedSections) {
+    for (int i = 0; i < 20; ++i) {
+        addSection("s" + std::to_string(i) + ".txt", "Part " + std::to_string(i), 1, "text", "Body");
+    }
+    std::mutex mutex;
+    std::condition_variable delivered;
+    uint64_t delivered_generation = 0;
+    std::vector<HtmlBlock> newest;
+    PreviewRenderer renderer([&](uint64_t generation, std::vector<HtmlBlock> blocks) {
+        std::lock_guard<std::mutex> lock(mutex);
+        delivered_generation = generation;
+        newest = std::move(blocks);
+        delivered.notify_one();
+    });
+    auto render = [&](const std::string& title) {
+        uint64_t generation = renderer.request(model, title);
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(delivered.wait_for(lock, std::chrono::seconds(10),
+                                       [&] { return delivered_generation == generation; }));
+        return newest;
+    };
+
+    render("Doc");
+    EXPECT_EQ(renderer.sectionsSent(), 20u);
+
+    // An edit, a move and a removal send one section; the rest stay on the worker
+    model.at(3).setContent("Edited");
+    EXPECT_TRUE(model.reorder({19, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18}));
+    model.erase(10);
+    std::vector<HtmlBlock> blocks = render("Doc");
+    EXPECT_EQ(renderer.sectionsSent(), 21u);
+
+    FragmentCache cache;
+    std::vector<HtmlBlock> expected = cache.generateHtmlBlocks(model, "Doc");
+    ASSERT_EQ(blocks.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(blocks[i].key, expected[i].key);
+        EXPECT_EQ(blocks[i].html, expected[i].html);
+    }
+
+    // Unchanged sections are not sent again for a new title
+    render("Renamed");
+    EXPECT_EQ(renderer.sectionsSent(), 21u);
+}
+
+TEST(HtmlRendererTest, WritesSectionsFromTheirData) {
+    std::string html;
+    HtmlWriter::appendTitle("A & B", html);
+    SectionData text;
+    text.headline = "Head";
+    text.level = 1;
+    text.type = "text";
+    text.setContent("# not a heading\n> not a quote\n\n<b>after</b>\n");
+    HtmlWriter::appendSection(text, html);
+    SectionData quote;
+    quote.level = 2;
+    quote.type = "quote";
+    quote.setContent("quoted\n```");
+    HtmlWriter::appendSection(quote, html);
+    SectionData box;
+    box.headline = "Code";
+    box.level = 3;
+    box.type = "box";
+    box.setContent("if (a < b) \"x\";");
+    HtmlWriter::appendSection(box, html);
+    EXPECT_EQ(html,
+              "<h1>A &amp; B</h1>\n"
+              "<h2>Head</h2>\n"
+              "<p># not a heading\n&gt; not a quote</p>\n"
+              "<p>&lt;b&gt;after&lt;/b&gt;</p>\n"
+              "<blockquote>quoted<br>\n```<br>\n</blockquote>\n"
+              "<h4>Code</h4>\n"
+              "<pre><code>if (a &lt; b) &quot;x&quot;;\n</code></pre>\n");
+}
+
+TEST(HtmlRendererTest, FindsSpecialBytesAtEveryOffset) {
+    // Lengths around the 16 and 32 byte vector widths, one special byte at each position
+    for (size_t length = 1; length <= 70; ++length) {
+        for (size_t at = 0; at < length; ++at) {
+            for (char special : {'&', '<', '>', '"', '\n'}) {
+                std::string text(length, 'a');
+                text[at] = special;
+                bool newline = special == '\n';
+                EXPECT_EQ(findHtmlSpecial(text, 0, true), at);
+                EXPECT_EQ(findHtmlSpecial(text, 0, false), newline ? length : at);
+                EXPECT_EQ(findHtmlSpecial(text, at + 1, true), length);
+            }
+        }
+    }
+
+    std::string html;
+    StringSink sink{html};
+    writeEscapedHtml(sink, std::string(40, 'x') + "<&>\"\n" + std::string(20, 'y'));
+    EXPECT_EQ(html, std::string(40, 'x') + "&lt;&amp;&gt;&quot;\n" + std::string(20, 'y'));
+}
+
+// FileSink Tests
+class FileSinkTest : public DocumentModelTest {};
+
+TEST_F(FileSinkTest, StreamsSmallAndLargePieces) {
+    std::string filename = "test_file_sink.md";
+    std::string large(FileSink::kDirectThreshold + 10, 'x');
+
+    FileSink sink(16); // Small buffer forces intermediate flushes
+    ASSERT_TRUE(sink.open(filename, large.size() + 64));
+    sink.append("head\n");
+    sink.append(large);
+    for (int i = 0; i < 10; ++i) {
+        sink.append("line\n");
+    }
+    ASSERT_TRUE(sink.commit());
+    EXPECT_EQ(sink.bytesWritten(), 5 + large.size() + 50);
+
+    std::string expected = "head\n" + large;
+    for (int i = 0; i < 10; ++i) {
+        expected += "line\n";
+    }
+    EXPECT_EQ(readFile(filename), expected);
+    std::remove(filename.c_str());
+}
+
+TEST_F(FileSinkTest, KeepsPermissionsOfReplacedFile) {
+    // A new file gets the same umask default as any other created file
+    std::ofstream("test_file_sink_plain.md") << "plain";
+    FileSink sink;
+    ASSERT_TRUE(sink.open("test_file_sink_mode.md"));
+    sink.append("new");
+    ASSERT_TRUE(sink.commit());
+    struct stat plain, created;
+    ASSERT_EQ(stat("test_file_sink_plain.md", &plain), 0);
+    ASSERT_EQ(stat("test_file_sink_mode.md", &created), 0);
+    EXPECT_EQ(created.st_mode & 07777, plain.st_mode & 07777);
+
+    ASSERT_EQ(chmod("test_file_sink_mode.md", 0640), 0);
+    ASSERT_TRUE(sink.open("test_file_sink_mode.md"));
+    sink.append("replaced");
+    ASSERT_TRUE(sink.commit());
+    struct stat replaced;
+    ASSERT_EQ(stat("test_file_sink_mode.md", &replaced), 0);
+    EXPECT_EQ(replaced.st_mode & 07777, 0640u);
+    std::remove("test_file_sink_plain.md");
+    std::remove("test_file_sink_mode.md");
+}
+
+TEST_F(FileSinkTest, DocumentWriterStreamsToFile) {
+    addSection("a.txt", "One", 1, "text", "Body one\n");
+    addSection("b.txt", "", 2, "quote", "quoted\nlines");
+
+    std::string filename = "test_export.md";
+    ASSERT_TRUE(DocumentWriter<MarkdownFormat>::writeFile(filename, model, "Title"));
+    EXPECT_EQ(readFile(filename), model.generateMarkdown("Title"));
+    std::remove(filename.c_str());
+
+    EXPECT_FALSE(DocumentWriter<MarkdownFormat>::writeFile("/nonexistent_dir/out.md", model, "Title"));
+}
+
+// ExportJob Tests
+class ExportJobTest : public DocumentModelTest {};
+
+TEST_F(ExportJobTest, WritesSnapshot) {
+    addSection("a.txt", "One", 1, "text", "Body one\n");
+    addSection("b.txt", "Two", 2, "box", "code");
+
+    std::string filename = "test_export_job.adoc";
+    ExportJob job(model, "Title", filename, ExportFormat::AsciiDoc);
+    std::string expected = model.generateAsciiDoc("Title");
+    model.clear(); // The job works on its own copy
+
+    EXPECT_EQ(job.run(), ExportJob::Status::Done);
+    EXPECT_DOUBLE_EQ(job.progress(), 1.0);
+    EXPECT_EQ(readFile(filename), expected);
+    std::remove(filename.c_str());
+}
+
+TEST_F(ExportJobTest, SinglePassWritesAllFormats) {
+    addSection("a.txt", "One", 1, "text", "Body one\n");
+    addSection("b.txt", "", 2, "quote", "quoted\nlines");
+    addSection("c.txt", "Code", 3, "box", "x = 1");
+
+    ExportJob job(model, "Title", {{ExportFormat::AsciiDoc, "test_all.adoc"},
+                                   {ExportFormat::Markdown, "test_all.md"},
+                                   {ExportFormat::Html, "test_all.html"}});
+    ASSERT_EQ(job.run(), ExportJob::Status::Done);
+
+    std::string markdown = model.generateMarkdown("Title");
+    EXPECT_EQ(readFile("test_all.adoc"), model.generateAsciiDoc("Title"));
+    EXPECT_EQ(readFile("test_all.md"), markdown);
+    // Same body as the preview, with the standalone page head
+    FragmentCache cache;
+    std::string preview = cache.generateHtmlPage(model, "Title");
+    EXPECT_EQ(readFile("test_all.html"), htmlDocumentHead() + preview.substr(htmlPageHead().size()));
+
+    std::remove("test_all.adoc");
+    std::remove("test_all.md");
+    std::remove("test_all.html");
+}
+
+TEST_F(ExportJobTest, ChapterExportWritesFilesAndIndex) {
+    addSection("pre.txt", "", 1, "text", "Preface");
+    addSection("a.txt", "Chapter A", 1, "text", "A body");
+    addSection("a2.txt", "Detail", 2, "text", "A detail");
+    addSection("b.txt", "Chapter B", 1, "quote", "B body");
+
+    std::vector<ChapterRange> chapters = splitChapters(model);
+    ASSERT_EQ(chapters.size(), 3u);
+    EXPECT_EQ(chapters[1].first, 1u);
+    EXPECT_EQ(chapters[1].last, 3u);
+    EXPECT_EQ(chapterFilePath("out/book.md", 1, 3), "out/book-02.md");
+
+    ExportJob job(model, "Book", {{ExportFormat::Markdown, "test_book.md", true}}, 2);
+    ASSERT_EQ(job.run(), ExportJob::Status::Done);
+
+    EXPECT_EQ(readFile("test_book.md"),
+              "# Book\n\n"
+              "1. [pre.txt](test_book-01.md)\n"
+              "2. [Chapter A](test_book-02.md)\n"
+              "3. [Chapter B](test_book-03.md)\n");
+    std::string joined = "# Book\n\n";
+    for (size_t c = 0; c < chapters.size(); ++c) {
+        joined += readFile(chapterFilePath("test_book.md", c, chapters.size()));
+        std::remove(chapterFilePath("test_book.md", c, chapters.size()).c_str());
+    }
+    EXPECT_EQ(joined, model.generateMarkdown("Book"));
+    std::remove("test_book.md");
+}
+
+TEST_F(ExportJobTest, IncrementalExportSkipsUnchangedFiles) {
+    addSection("a.txt", "Chapter A", 1, "text", "A body");
+    addSection("b.txt", "Chapter B", 1, "text", "B body");
+
+    auto exportChapters = [this]() {
+        ExportJob job(model, "Book", {{ExportFormat::Markdown, "test_inc.md", true}});
+        job.setIncremental(true);
+        EXPECT_EQ(job.run(), ExportJob::Status::Done);
+        return std::make_pair(job.filesWritten(), job.filesSkipped());
+    };
+    EXPECT_EQ(exportChapters(), std::make_pair(size_t(3), size_t(0)));
+    EXPECT_EQ(exportChapters(), std::make_pair(size_t(0), size_t(3)));
+
+    // Only the edited chapter is regenerated; the index lists the same files
+    model.at(1).setContent("B edited");
+    EXPECT_EQ(exportChapters(), std::make_pair(size_t(1), size_t(2)));
+    EXPECT_EQ(readFile("test_inc-02.md"), "## Chapter B\n\nB edited\n\n");
+
+    ExportManifest manifest;
+    ASSERT_TRUE(manifest.load(ExportManifest::pathFor("test_inc.md")));
+    EXPECT_EQ(manifest.options, "markdown+chapters");
+    EXPECT_EQ(manifest.section_hashes.size(), 2u);
+    EXPECT_EQ(manifest.files.size(), 3u);
+
+    std::remove("test_inc.md");
+    std::remove("test_inc-01.md");
+    std::remove("test_inc-02.md");
+    std::remove(ExportManifest::pathFor("test_inc.md").c_str());
+}
+
+TEST_F(ExportJobTest, CancelledExportLeavesNoFile) {
+    addSection("a.txt", "One", 1, "text", "Body");
+
+    std::string filename = "test_export_cancelled.md";
+    ExportJob job(model, "", filename, ExportFormat::Markdown);
+    job.cancel();
+    EXPECT_EQ(job.run(), ExportJob::Status::Cancelled);
+    EXPECT_FALSE(std::ifstream(filename).good());
+
+    ExportJob failing(model, "", "/nonexistent_dir/out.md", ExportFormat::Markdown);
+    EXPECT_EQ(failing.run(), ExportJob::Status::Failed);
+}
+
+// BookFile Tests
+class BookFileTest : public DocumentModelTest {};
+
+TEST_F(BookFileTest, AssemblesNestedSets) {
+    addSection("a.txt", "Part A", 1, "text", "A body");
+    ASSERT_TRUE(SetFile::save("test_book_a.docgenset", model, "Set A"));
+    model.clear();
+    addSection("b.txt", "Part B", 1, "text", "B body");
+    addSection("b2.txt", "Deep", 3, "text", "B detail");
+    ASSERT_TRUE(SetFile::save("test_book_b.docgenset", model, "Set B"));
+
+    auto write = [](const std::string& filename, const std::string& text) {
+        std::ofstream(filename) << text;
+    };
+    // The nested book includes set A again; it is loaded only once
+    write("test_book_inner.docgenbook", "include: test_book_b.docgenset offset=1\ninclude: test_book_a.docgenset\n");
+    write("test_book.docgenbook",
+          "# Whole book\ntitle: Book\ninclude: test_book_a.docgenset\ninclude: test_book_inner.docgenbook offset=1\n");
+
+    DocumentModel book;
+    std::string title, error;
+    ASSERT_TRUE(BookFile::build("test_book.docgenbook", book, title, error, 2)) << error;
+    EXPECT_EQ(title, "Book");
+    ASSERT_EQ(book.size(), 4u);
+    EXPECT_EQ(book.at(1).headline, "Part B");
+    EXPECT_EQ(book.at(1).level, 3);
+    EXPECT_EQ(book.at(2).level, 3); // Clamped
+    EXPECT_EQ(book.at(3).level, 2);
+    EXPECT_EQ(book.at(3).body(), "A body");
+    EXPECT_NE(book.at(0).id, book.at(3).id);
+
+    ExportJob job(DocumentModel(), "", "test_book_out.md", ExportFormat::Markdown);
+    job.setBookSource("test_book.docgenbook");
+    ASSERT_EQ(job.run(), ExportJob::Status::Done);
+    EXPECT_EQ(readFile("test_book_out.md"), book.generateMarkdown("Book"));
+
+    write("test_book_inner.docgenbook", "include: test_book.docgenbook\n");
+    EXPECT_FALSE(BookFile::build("test_book.docgenbook", book, title, error));
+    EXPECT_NE(error.find("Include cycle"), std::string::npos);
+
+    BookManifest manifest;
+    EXPECT_FALSE(BookFile::parse("include: x.docgenset offset=two\n", manifest, error));
+
+    for (const char* filename : {"test_book_a.docgenset", "test_book_b.docgenset", "test_book_inner.docgenbook",
+                                 "test_book.docgenbook", "test_book_out.md"}) {
+        std::remove(filename);
+    }
+}
+
+// BatchExport Tests
+class BatchExportTest : public DocumentModelTest {};
+
+TEST_F(BatchExportTest, WritesEachInput) {
+    BatchOptions options;
+    std::string error;
+    ASSERT_TRUE(BatchExport::parseArguments({"--format=html", "--jobs", "3", "-o", "out", "a.docgenset"},
+                                            options, error));
+    EXPECT_EQ(options.format, ExportFormat::Html);
+    EXPECT_EQ(options.jobs, 3u);
+    EXPECT_EQ(BatchExport::outputPath(options, "sets/a.docgenset"), "out/a.html");
+    EXPECT_FALSE(BatchExport::parseArguments({"--format=pdf", "-o", "out", "a.docgenset"}, options, error));
+    EXPECT_FALSE(BatchExport::parseArguments({"--format=md", "a.docgenset"}, options, error));
+
+    addSection("a.txt", "One", 1, "text", "Body");
+    ASSERT_TRUE(SetFile::save("test_batch_a.docgenset", model, "A"));
+    addSection("b.txt", "Two", 2, "quote", "More");
+    ASSERT_TRUE(SetFile::save("test_batch_b.docgenset", model, "B"));
+
+    std::ostringstream out, err;
+    EXPECT_EQ(BatchExport::main({"--format=md", "-j", "2", "-o", "test_batch_out", "test_batch_a.docgenset",
+                                 "test_batch_b.docgenset", "missing.docgenset"}, out, err), 1);
+    EXPECT_NE(err.str().find("missing.docgenset"), std::string::npos);
+
+    EXPECT_EQ(readFile("test_batch_out/test_batch_b.md"), model.generateMarkdown("B"));
+
+    for (const char* filename : {"test_batch_out/test_batch_a.md", "test_batch_out/test_batch_b.md", "test_batch_out",
+                                 "test_batch_a.docgenset", "test_batch_b.docgenset"}) {
+        std::remove(filename);
+    }
+}
+
+// WatchExport Tests
+class WatchExportTest : public DocumentModelTest {};
+
+TEST_F(WatchExportTest, RebuildRendersOnlyEditedSections) {
+    addSection("a.txt", "One", 1, "text", "First");
+    addSection("b.txt", "Two", 2, "text", "Second");
+    addSection("c.txt", "Three", 1, "box", "Third");
+    ASSERT_TRUE(SetFile::save("test_watch.docgenset", model, "Watched"));
+
+    BatchOptions options;
+    options.format = ExportFormat::Markdown;
+    options.output_dir = ".";
+    WatchExport watch(options);
+    std::vector<BatchResult> results = watch.rebuild({"test_watch.docgenset"});
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_TRUE(results[0].ok);
+    EXPECT_EQ(results[0].output, "./test_watch.md");
+    size_t renders = watch.renderCount();
+    EXPECT_EQ(renders, 3u);
+
+    // Unchanged: nothing is rendered or written
+    results = watch.rebuild({"test_watch.docgenset"});
+    EXPECT_TRUE(results[0].skipped);
+
+    // One edit and a move: only the edited section is rendered again
+    model.at(1).setContent("Edited");
+    model.reorder({2, 0, 1});
+    ASSERT_TRUE(SetFile::save("test_watch.docgenset", model, "Watched"));
+    results = watch.rebuild({"test_watch.docgenset"});
+    EXPECT_TRUE(results[0].ok);
+    EXPECT_FALSE(results[0].skipped);
+    EXPECT_EQ(watch.renderCount(), renders + 1);
+
+    EXPECT_EQ(readFile("test_watch.md"), model.generateMarkdown("Watched"));
+
+    // A deleted set is reported, not failed, and its output goes with it
+    std::remove("test_watch.docgenset");
+    results = watch.rebuild({"test_watch.docgenset"});
+    EXPECT_TRUE(results[0].ok);
+    EXPECT_TRUE(results[0].removed);
+    EXPECT_EQ(results[0].output, "./test_watch.md");
+    EXPECT_EQ(watch.setCount(), 0u);
+    EXPECT_FALSE(std::ifstream("test_watch.md").good());
+}
+
+TEST_F(WatchExportTest, RejectsIncrementalOption) {
+    std::ostringstream out, err;
+    EXPECT_EQ(WatchExport::main({"--format=md", "--incremental", "-o", ".", "."}, out, err), 2);
+    EXPECT_NE(err.str().find("--incremental"), std::string::npos);
+}
+
+// WarmSet Tests
+TEST(WarmSetTest, ReloadsSetsRewrittenInPlace) {
+    // Bodies spanning several pages are read from the mapping of the file
+    DocumentModel large;
+    for (char c : std::string("abcd")) {
+        SectionData data;
+        data.header = std::string(1, c) + ".txt";
+        data.content = std::string(8192, c);
+        large.append(data);
+    }
+    ASSERT_TRUE(SetFile::save("test_warm.docgenset", large, "Warm"));
+    WarmSet set;
+    ASSERT_TRUE(set.load("test_warm.docgenset"));
+    uint64_t kept_id = set.model().at(1).id;
+
+    // Truncating the mapped file must not make the reload touch old bodies
+    DocumentModel small;
+    small.append(large.at(1));
+    ASSERT_TRUE(SetFile::save("test_warm_small.docgenset", small, "Warm"));
+    std::ofstream("test_warm.docgenset", std::ios::trunc) << readFile("test_warm_small.docgenset");
+
+    ASSERT_TRUE(set.load("test_warm.docgenset"));
+    ASSERT_EQ(set.model().size(), 1u);
+    EXPECT_EQ(set.model().at(0).id, kept_id);
+    EXPECT_EQ(set.render(ExportFormat::Markdown), small.generateMarkdown("Warm"));
+    std::remove("test_warm.docgenset");
+    std::remove("test_warm_small.docgenset");
+}
+
+// RenderServer Tests
+class RenderServerTest : public DocumentModelTest {};
+
+TEST_F(RenderServerTest, AnswersPathAndContentRequests) {
+    addSection("a.txt", "One", 1, "text", "Body");
+    addSection("b.txt", "Two", 2, "quote", "Quoted");
+    ASSERT_TRUE(SetFile::save("test_server.docgenset", model, "Served"));
+
+    RenderServer server(2);
+    std::string error;
+    ASSERT_TRUE(server.listen("test_server.sock", error)) << error;
+    std::thread serving([&server]() { server.serve(); });
+
+    std::string document;
+    EXPECT_TRUE(RenderServer::request("test_server.sock", "md path test_server.docgenset", "", document, error));
+    EXPECT_EQ(document, model.generateMarkdown("Served"));
+    std::string content = readFile("test_server.docgenset");
+    EXPECT_TRUE(RenderServer::request("test_server.sock", "adoc content " + std::to_string(content.size()),
+                                      content, document, error));
+    EXPECT_EQ(document, model.generateAsciiDoc("Served"));
+    EXPECT_FALSE(RenderServer::request("test_server.sock", "pdf path test_server.docgenset", "", document, error));
+    EXPECT_FALSE(RenderServer::request("test_server.sock", "md path missing.docgenset", "", document, error));
+
+    server.stop();
+    serving.join();
+    EXPECT_FALSE(std::ifstream("test_server.sock").good());
+    std::remove("test_server.docgenset");
+}
+
+TEST_F(RenderServerTest, ReloadsPathSetsRewrittenInPlace) {
+    for (char c : std::string("abcd")) {
+        addSection(std::string(1, c) + ".txt", "", 1, "text", std::string(8192, c));
+    }
+    ASSERT_TRUE(SetFile::save("test_server_large.docgenset", model, "Served"));
+    DocumentModel small;
+    small.append(model.at(2));
+    ASSERT_TRUE(SetFile::save("test_server_small.docgenset", small, "Served"));
+
+    RenderServer server(1);
+    std::string error;
+    ASSERT_TRUE(server.listen("test_server_rewrite.sock", error)) << error;
+    std::thread serving([&server]() { server.serve(); });
+
+    std::string document;
+    EXPECT_TRUE(RenderServer::request("test_server_rewrite.sock", "md path test_server_large.docgenset", "",
+                                      document, error));
+    EXPECT_EQ(document, model.generateMarkdown("Served"));
+
+    // The warm set still maps the old, longer file when it is truncated
+    std::ofstream("test_server_large.docgenset", std::ios::trunc) << readFile("test_server_small.docgenset");
+    EXPECT_TRUE(RenderServer::request("test_server_rewrite.sock", "md path test_server_large.docgenset", "",
+                                      document, error));
+    EXPECT_EQ(document, small.generateMarkdown("Served"));
+
+    server.stop();
+    serving.join();
+    std::remove("test_server_large.docgenset");
+    std::remove("test_server_small.docgenset");
+}
+
+TEST_F(RenderServerTest, KeepsServingAfterAcceptFails) {
+    addSection("a.txt", "One", 1, "text", "Body");
+    ASSERT_TRUE(SetFile::save("test_server_limit.docgenset", model, "Served"));
+    RenderServer server(1);
+    std::string error;
+    ASSERT_TRUE(server.listen("test_server_limit.sock", error)) << error;
+    std::stringstream log;
+    std::thread serving([&server, &log]() { server.serve(&log); });
+    std::string document;
+    ASSERT_TRUE(RenderServer::request("test_server_limit.sock", "md path test_server_limit.docgenset", "", document,
+                                      error));
+
+    // Use up the descriptors, leaving one for the client, so accept fails
+    struct rlimit limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+    struct rlimit lowered = limit;
+    lowered.rlim_cur = std::min<rlim_t>(limit.rlim_cur, 256);
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &lowered), 0);
+    std::vector<int> spare;
+    for (int fd; (fd = ::open("/dev/null", O_RDONLY)) >= 0;) {
+        spare.push_back(fd);
+    }
+    ASSERT_FALSE(spare.empty());
+    ::close(spare.back());
+    spare.pop_back();
+
+    document.clear();
+    bool answered = false;
+    std::thread client([&]() {
+        std::string client_error;
+        answered = RenderServer::request("test_server_limit.sock", "md path test_server_limit.docgenset", "",
+                                         document, client_error);
+    });
+    for (int i = 0; i < 200 && server.acceptErrors() == 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    size_t failures = server.acceptErrors();
+    setrlimit(RLIMIT_NOFILE, &limit); // Frees descriptors above the lowered limit at once
+    for (int fd : spare) {
+        ::close(fd);
+    }
+    client.join();
+    EXPECT_GT(failures, 0u);
+    EXPECT_TRUE(answered);
+    EXPECT_EQ(document, model.generateMarkdown("Served"));
+
+    server.stop();
+    serving.join();
+    EXPECT_NE(log.str().find("retrying"), std::string::npos);
+    std::remove("test_server_limit.docgenset");
+}
+
+TEST_F(RenderServerTest, KeepsOnlyRecentPathSets) {
+    addSection("a.txt", "One", 1, "text", "Body");
+    RenderServer server(1);
+    std::string document, error;
+    auto name = [](size_t i) { return "test_server_set" + std::to_string(i) + ".docgenset"; };
+    for (size_t i = 0; i <= RenderServer::kMaxPathSets; ++i) {
+        ASSERT_TRUE(SetFile::save(name(i), model, "Set"));
+        EXPECT_TRUE(server.handle("md path " + name(i), "", document, error));
+        if (i == 1) {
+            EXPECT_TRUE(server.handle("md path " + name(0), "", document, error)); // Used again, so kept
+        }
+    }
+    // The least recently used set made room for the newest one
+    EXPECT_EQ(server.pathSetCount(), RenderServer::kMaxPathSets);
+    EXPECT_TRUE(server.hasPathSet(name(0)));
+    EXPECT_FALSE(server.hasPathSet(name(1)));
+    EXPECT_TRUE(server.hasPathSet(name(RenderServer::kMaxPathSets)));
+
+    // Paths that no longer load are dropped right away
+    std::remove(name(0).c_str());
+    EXPECT_FALSE(server.handle("md path " + name(0), "", document, error));
+    EXPECT_EQ(server.pathSetCount(), RenderServer::kMaxPathSets - 1);
+    for (size_t i = 1; i <= RenderServer::kMaxPathSets; ++i) {
+        std::remove(name(i).c_str());
+    }
+}
+
+TEST_F(RenderServerTest, RefusesToReplaceFilesThatAreNotSockets) {
+    std::ofstream("test_server_file.sock") << "keep";
+    RenderServer server(1);
+    std::string error;
+    EXPECT_FALSE(server.listen("test_server_file.sock", error));
+    EXPECT_NE(error.find("not a socket"), std::string::npos);
+    std::ifstream in("test_server_file.sock");
+    std::string kept;
+    in >> kept;
+    EXPECT_EQ(kept, "keep");
+    std::remove("test_server_file.sock");
+}
+
+TEST_F(SectionManagerTest, DeleteSectionById) {
+    manager->addSection("First", "Content 1");
+    manager->addSection("Second", "Content 2");
+    manager->addSection("Third", "Content 3");
+
+    TextSection* middle = manager->getSectionAt(1);
+    uint64_t middle_id = middle->getId();
+    EXPECT_EQ(manager->findSection(middle_id), middle);
+
+    manager->deleteSection(middle);
+    EXPECT_EQ(manager->getSectionCount(), 2);
+    EXPECT_EQ(manager->findSection(middle_id), nullptr);
+
+    auto sections = manager->getSectionsInOrder();
+    ASSERT_EQ(sections.size(), 2u);
+    EXPECT_EQ(sections[0].first, "First");
+    EXPECT_EQ(sections[1].first, "Third");
+}
+
+// SetFile Tests
+TEST(SetFileTest, ParsesSectionsAndTitle) {
+    ParsedSet parsed;
+    SetFile::parse("[DOCUMENT_TITLE:Title]\n"
+                   "[SECTION:a.txt]\n"
+                   "[HEADLINE:Head]\n"
+                   "[LEVEL:3]\n"
+                   "[TYPE:quote]\n"
+                   "Line 1\n"
+                   "\n"
+                   "Line 3\n"
+                   "[END_SECTION]\n"
+                   "\n"
+                   "[SECTION:b.txt]\n"
+                   "Only content\n"
+                   "[END_SECTION]", parsed);
+
+    EXPECT_EQ(parsed.document_title, "Title");
+    ASSERT_EQ(parsed.sections.size(), 2u);
+    EXPECT_EQ(parsed.sections[0].header, "a.txt");
+    EXPECT_EQ(parsed.sections[0].headline, "Head");
+    EXPECT_EQ(parsed.sections[0].level, 3);
+    EXPECT_EQ(parsed.sections[0].type, "quote");
+    EXPECT_EQ(parsed.sections[0].content, "Line 1\n\nLine 3");
+    EXPECT_EQ(parsed.sections[1].header, "b.txt");
+    EXPECT_EQ(parsed.sections[1].level, 2);
+    EXPECT_EQ(parsed.sections[1].type, "text");
+    EXPECT_EQ(parsed.sections[1].content, "Only content");
+}
+
+TEST(SetFileTest, InvalidLevelAndUnterminatedSection) {
+    ParsedSet parsed;
+    SetFile::parse("[SECTION:a]\n[LEVEL:abc]\nbody\n[END_SECTION]\n[SECTION:b]\nnever closed\n", parsed);
+
+    ASSERT_EQ(parsed.sections.size(), 1u);
+    EXPECT_EQ(parsed.sections[0].level, 2);
+    EXPECT_EQ(parsed.sections[0].content, "body");
+}
+
+TEST(SetFileTest, LoadMissingAndEmptyFile) {
+    ParsedSet parsed;
+    EXPECT_FALSE(SetFile::load("non_existent_set_123456.docgenset", parsed));
+
+    std::ofstream file("test_empty_mapped.docgenset");
+    file.close();
+    EXPECT_TRUE(SetFile::load("test_empty_mapped.docgenset", parsed));
+    EXPECT_TRUE(parsed.sections.empty());
+    std::remove("test_empty_mapped.docgenset");
+}
+
+TEST(SetFileTest, IndexedRoundTripAndRandomAccess) {
+    DocumentModel model;
+    SectionData first;
+    first.header = "a.txt";
+    first.headline = "Head";
+    first.level = 3;
+    first.type = "box";
+    first.content = "before\n[END_SECTION]\nafter\n";
+    model.append(first);
+    SectionData second;
+    second.header = "b.txt";
+    second.type = "quote";
+    second.content = "";
+    model.append(second);
+
+    FileSink out;
+    ASSERT_TRUE(out.open("test_indexed.docgenset"));
+    SetFile::writeV2(out, model, "Title");
+    ASSERT_TRUE(out.commit());
+    std::string data = readFile("test_indexed.docgenset");
+    std::remove("test_indexed.docgenset");
+    EXPECT_TRUE(SetFile::isIndexed(data));
+
+    SetIndexReader reader;
+    ASSERT_TRUE(reader.open(data));
+    EXPECT_EQ(reader.documentTitle(), "Title");
+    ASSERT_EQ(reader.size(), 2u);
+    SectionView view;
+    ASSERT_TRUE(reader.section(1, view));
+    EXPECT_EQ(view.header, "b.txt");
+    EXPECT_EQ(view.type, "quote");
+    EXPECT_FALSE(reader.section(2, view));
+
+    ParsedSet parsed;
+    ASSERT_TRUE(SetFile::parse(data, parsed));
+    ASSERT_EQ(parsed.sections.size(), 2u);
+    EXPECT_EQ(parsed.sections[0].headline, "Head");
+    EXPECT_EQ(parsed.sections[0].level, 3);
+    EXPECT_EQ(parsed.sections[0].type, "box");
+    EXPECT_EQ(parsed.sections[0].content, "before\n[END_SECTION]\nafter\n");
+
+    // Truncated files are rejected rather than read past the end
+    ParsedSet truncated;
+    EXPECT_FALSE(SetFile::parse(data.substr(0, data.size() - 4), truncated));
+}
+
+TEST(SetFileTest, SaveLegacyFormat) {
+    DocumentModel model;
+    SectionData section;
+    section.header = "a.txt";
+    section.content = "Body";
+    model.append(section);
+
+    std::string filename = "test_legacy_set.docgenset";
+    EXPECT_TRUE(SetFile::save(filename, model, "Title", SetFormat::V1));
+
+    std::ifstream input(filename);
+    std::string first_line;
+    std::getline(input, first_line);
+    EXPECT_EQ(first_line, "[DOCUMENT_TITLE:Title]");
+    input.close();
+
+    ParsedSet parsed;
+    EXPECT_TRUE(SetFile::load(filename, parsed));
+    EXPECT_EQ(parsed.document_title, "Title");
+    ASSERT_EQ(parsed.sections.size(), 1u);
+    EXPECT_EQ(parsed.sections[0].body(), "Body");
+    std::remove(filename.c_str());
+}
+
+TEST(SetFileTest, ParallelParseMatchesSequential) {
+    // Large enough to be split into chunks at [SECTION: lines
+    std::string data = "[DOCUMENT_TITLE:Big]\n";
+    for (int i = 0; data.size() < (2u << 20); ++i) {
+        data += "[SECTION:s" + std::to_string(i) + "]\n";
+        data += "[LEVEL:" + std::to_string(i % 3 + 1) + "]\n";
+        data += "line " + std::to_string(i) + "\n\nmore text\n";
+        if (i % 97 != 0) data += "[END_SECTION]\n";
+    }
+
+    ParsedSet sequential;
+    ParsedSet parallel;
+    SetFile::parseV1(data, sequential, nullptr, 1);
+    SetFile::parseV1(data, parallel, nullptr, 8);
+
+    EXPECT_EQ(parallel.document_title, "Big");
+    ASSERT_EQ(parallel.sections.size(), sequential.sections.size());
+    for (size_t i = 0; i < sequential.sections.size(); ++i) {
+        EXPECT_EQ(parallel.sections[i].header, sequential.sections[i].header);
+        EXPECT_EQ(parallel.sections[i].level, sequential.sections[i].level);
+        EXPECT_EQ(parallel.sections[i].body(), sequential.sections[i].body());
+    }
+}
+
+TEST_F(SectionManagerTest, ModelTracksSectionEdits) {
+    manager->addSection("Section 1", "Content 1");
+    manager->getSectionAt(0)->setHeadline("Edited");
+    manager->getSectionAt(0)->setHeadlineLevel(3);
+    manager->getSectionAt(0)->setSectionType("quote");
+    manager->getSectionAt(0)->setContent("New content");
+
+    const SectionData& data = manager->getModel().at(0);
+    EXPECT_EQ(data.headline, "Edited");
+    EXPECT_EQ(data.level, 3);
+    EXPECT_EQ(data.type, "quote");
+    EXPECT_EQ(data.content, "New content");
+}
+
+TEST_F(SectionManagerTest, LoadLeavesContentInMapping) {
+    std::string filename = "test_lazy_content.docgenset";
+    manager->addSection("Lazy", "Line 1\nLine 2");
+    EXPECT_TRUE(manager->saveToFile(filename));
+    manager->clearAll();
+
+    EXPECT_TRUE(manager->loadFromFile(filename));
+    TextSection* section = manager->getSectionAt(0);
+    ASSERT_NE(section, nullptr);
+    EXPECT_FALSE(manager->getModel().at(0).isContentLoaded());
+    EXPECT_TRUE(section->isContentPending());
+    EXPECT_EQ(section->getContent(), "Line 1\nLine 2");
+    EXPECT_EQ(manager->generateMarkdown(""), "Line 1\nLine 2\n\n");
+
+    // Filling the buffer does not copy the body into the model
+    section->ensureContentLoaded();
+    EXPECT_FALSE(section->isContentPending());
+    EXPECT_EQ(section->getContent(), "Line 1\nLine 2");
+    EXPECT_FALSE(manager->getModel().at(0).isContentLoaded());
+
+    // Saving over the mapped file keeps the lazy body readable
+    EXPECT_TRUE(manager->saveToFile(filename));
+    EXPECT_EQ(manager->getModel().at(0).body(), "Line 1\nLine 2");
+
+    section->setContent("Edited");
+    EXPECT_TRUE(manager->getModel().at(0).isContentLoaded());
+    EXPECT_EQ(manager->getModel().at(0).content, "Edited");
+    std::remove(filename.c_str());
+}
+
+TEST_F(SectionManagerTest, BatchedUpdatesNotifyOnce) {
+    int notifications = 0;
+    manager->setOnContentChangedCallback([&notifications]() { notifications++; });
+
+    {
+        SectionManager::UpdateScope scope(*manager);
+        manager->addSection("A", "1");
+        manager->addSection("B", "2");
+        {
+            SectionManager::UpdateScope nested(*manager);
+            manager->addSection("C", "3");
+        }
+        manager->flushContentChanged();
+        EXPECT_EQ(notifications, 0);
+    }
+    manager->flushContentChanged();
+    EXPECT_EQ(notifications, 1);
+
+    // An empty batch does not notify
+    manager->beginUpdate();
+    manager->commitUpdate();
+    manager->flushContentChanged();
+    EXPECT_EQ(notifications, 1);
+
+    // Loading a set replaces all sections with a single notification
+    std::string filename = "test_batched_load.docgenset";
+    EXPECT_TRUE(manager->saveToFile(filename));
+    notifications = 0;
+    EXPECT_TRUE(manager->loadFromFile(filename));
+    manager->flushContentChanged();
+    EXPECT_EQ(manager->getSectionCount(), 3);
+    EXPECT_EQ(notifications, 1);
+    std::remove(filename.c_str());
+}
+
+TEST_F(SectionManagerTest, EditsCoalesceIntoOneNotification) {
+    int notifications = 0;
+    manager->addSection("A", "1");
+    manager->setOnContentChangedCallback([&notifications]() { notifications++; });
+
+    // Per-keystroke edits only schedule a notification
+    manager->getSectionAt(0)->setHeadline("H");
+    manager->getSectionAt(0)->setHeadline("He");
+    manager->getSectionAt(0)->setHeadline("Hel");
+    EXPECT_EQ(notifications, 0);
+
+    while (g_main_context_iteration(NULL, FALSE)) {
+    }
+    EXPECT_EQ(notifications, 1);
+    EXPECT_EQ(manager->getModel().at(0).headline, "Hel");
+
+    // Nothing pending, nothing to flush
+    manager->flushContentChanged();
+    EXPECT_EQ(notifications, 1);
+}
+
 // Main function with GTK environment setup
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);